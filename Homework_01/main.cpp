@@ -4,6 +4,8 @@
 #include <vector>
 #include "Line.h"
 #include "Circle.h"
+#include "Headless.h"
+#include "FrameScheduler.h"
 
 // Typedefs.
 typedef Utils::Line<GLdouble> Line;
@@ -56,7 +58,7 @@ Line bigHand(CENTER.x(), CENTER.y(), CENTER.x(), CENTER.y() + bigHandLength);
 Line smallHand(CENTER.x(), CENTER.y(),
                CENTER.x() + smallHandLength, CENTER.y());
 
-// Refresh rate in miliseconds.
+// Update step in miliseconds.
 size_t refreshRate = 50;
 
 // Degrees to radians.
@@ -106,10 +108,10 @@ void init()
 // Draw grid function.
 void drawGrid()
 {
-  glLineWidth(gridLineWidth);
+  Utils::renderLineWidth(gridLineWidth);
   gridColor.setGLColor();
 
-  glBegin(GL_LINES);
+  Utils::renderBegin(GL_LINES);
 
   for (size_t i = 1; i < handSegments; i++)
   {
@@ -119,12 +121,27 @@ void drawGrid()
     Utils::glVertex2<GLdouble>(smallHand.pointAt(seg));
   }
 
-  glEnd();
+  Utils::renderEnd();
+}
+
+// Place the hands between their last and next rotation.
+void placeHands(GLdouble alpha)
+{
+  // Calculate new position of big hands endpoint.
+  GLdouble rot = degToRad(bigHandRot - alpha);
+  bigHand.setP2(CENTER.x() + bigHandLength * cos(rot),
+                CENTER.y() + bigHandLength * sin(rot));
+
+  // Same for small hand
+  rot = degToRad(smallHandRot - alpha / 12.0);
+  smallHand.setP2(CENTER.x() + smallHandLength * cos(rot),
+                  CENTER.y() + smallHandLength * sin(rot));
 }
 
 // Main display function.
 void clockDisplay()
 {
+  placeHands(Utils::FrameScheduler::alpha());
   glClear(GL_COLOR_BUFFER_BIT);
 
   // Draw Circle.
@@ -142,21 +159,11 @@ void clockDisplay()
   // Draw center point.
   mainCircle.drawCenterPoint();
 
-  glutSwapBuffers();
+  Utils::Headless::swapBuffers();
 }
 
-void clockUpdate(int n)
+void clockUpdate()
 {
-  // Calculate new position of big hands endpoint.
-  GLdouble rot = degToRad(bigHandRot);
-  bigHand.setP2(CENTER.x() + bigHandLength * cos(rot),
-                CENTER.y() + bigHandLength * sin(rot));
-
-  // Same for small hand
-  rot = degToRad(smallHandRot);
-  smallHand.setP2(CENTER.x() + smallHandLength * cos(rot),
-                  CENTER.y() + smallHandLength * sin(rot));
-
   // Adjust their rotation degree.
   bigHandRot--;
   smallHandRot -= 1.0 / 12.0;
@@ -166,22 +173,15 @@ void clockUpdate(int n)
   {
     bigHandRot = 90.0;
   }
-
-  glutPostRedisplay();
-  glutTimerFunc(refreshRate, clockUpdate, 0);
 }
 
 int main(int argc, char **argv)
 {
-  glutInit(&argc, argv);
-  glutInitDisplayMode(GLUT_DOUBLE | GLUT_RGB);
-  glutInitWindowSize(WIDTH, HEIGHT);
-  glutInitWindowPosition(100, 100);
-  glutCreateWindow("Homework 01");
+  Utils::Headless::createWindow(argc, argv, "Homework 01", WIDTH, HEIGHT,
+                                100, 100);
 
   init();
-  glutDisplayFunc(clockDisplay);
-  glutTimerFunc(refreshRate, clockUpdate, 0);
-  glutMainLoop();
-  return 0;
+  Utils::Headless::displayFunc(clockDisplay);
+  Utils::FrameScheduler::start(refreshRate, clockUpdate);
+  return Utils::Headless::mainLoop();
 }
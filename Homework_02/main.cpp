@@ -5,6 +5,8 @@
 #include "Line.h"
 #include "Vector2D.h"
 #include "Circle.h"
+#include "Headless.h"
+#include "FrameScheduler.h"
 
 // Typedefs -------------------------------------------------------------------
 typedef Utils::Point2D<GLdouble> Point2D;
@@ -21,7 +23,7 @@ const Utils::Color bgColor(Utils::WHITE);
 const Utils::Color ball1Color(Utils::BLUE);
 const Utils::Color ball2Color(Utils::RED);
 
-// Refresh rate ---------------------------------------------------------------
+// Game step in ms ------------------------------------------------------------
 const size_t refreshRate = 5;
 
 // Movement rate of the bat ---------------------------------------------------
@@ -325,7 +327,6 @@ void detectFoodCollision()
 // Display function -----------------------------------------------------------
 void display()
 {
-  keyOperations();
   glClear(GL_COLOR_BUFFER_BIT);
 
   line.draw();
@@ -336,7 +337,13 @@ void display()
   food1.draw();
   food2.draw();
 
-  glutSwapBuffers();
+  Utils::Headless::swapBuffers();
+}
+
+// Game step, once every refreshRate ms ---------------------------------------
+void gameUpdate()
+{
+  keyOperations();
 
   ball1.translate(vec1);
   ball2.translate(vec2);
@@ -348,27 +355,25 @@ void display()
   detectFoodCollision();
 }
 
-void gameUpdate(int n)
-{
-  glutPostRedisplay();
-  glutTimerFunc(refreshRate, gameUpdate, 0);
-}
-
 // Main function --------------------------------------------------------------
 int main(int argc, char *argv[])
 {
-  glutInit(&argc, argv);
-  glutSetOption(GLUT_ACTION_ON_WINDOW_CLOSE,
-                GLUT_ACTION_GLUTMAINLOOP_RETURNS);
-  glutInitDisplayMode(GLUT_DOUBLE | GLUT_RGB);
-  glutInitWindowSize(WIDTH, HEIGHT);
-  glutCreateWindow("Homework 02");
+  Utils::Headless::createWindow(argc, argv, "Homework 02", WIDTH, HEIGHT);
+
+  if (!Utils::Headless::active())
+    glutSetOption(GLUT_ACTION_ON_WINDOW_CLOSE,
+                  GLUT_ACTION_GLUTMAINLOOP_RETURNS);
 
   init();
-  glutDisplayFunc(display);
-  glutKeyboardFunc(keyPressed);
-  glutKeyboardUpFunc(keyUp);
-  glutTimerFunc(refreshRate, gameUpdate, 0);
-  glutMainLoop();
-  return 0;
+  Utils::Headless::displayFunc(display);
+
+  // no input without a window
+  if (!Utils::Headless::active())
+  {
+    glutKeyboardFunc(keyPressed);
+    glutKeyboardUpFunc(keyUp);
+  }
+
+  Utils::FrameScheduler::start(refreshRate, gameUpdate);
+  return Utils::Headless::mainLoop();
 }
@@ -3,6 +3,7 @@
 #include <cmath>
 #include "Slider.h"
 #include "Circle.h"
+#include "Headless.h"
 
 // Typedefs.
 typedef Utils::Slider Slider;
@@ -45,6 +46,7 @@ void init()
 
 void display()
 {
+  Utils::Damage::beginFrame();
   glClear(GL_COLOR_BUFFER_BIT);
   circ.draw();
   size_t asd = static_cast<size_t>(1 + (numbersSlider.getValue() *
@@ -53,7 +55,8 @@ void display()
   progressSlider.draw();
   numbersSlider.draw();
   radiusSlider.draw();
-  glutSwapBuffers();
+  Utils::Damage::endFrame();
+  Utils::Headless::swapBuffers();
 }
 
 void processMouse(GLint button, GLint action, GLint xMouse, GLint yMouse)
@@ -75,6 +78,10 @@ void processMouse(GLint button, GLint action, GLint xMouse, GLint yMouse)
 
 void processMouseActiveMotion(GLint xMouse, GLint yMouse)
 {
+  int progress = progressSlider.getValue();
+  int numbers = numbersSlider.getValue();
+  int radius = radiusSlider.getValue();
+
   if (progressSlider.isDragging())
   {
     progressSlider.setHandlePos(xMouse);
@@ -91,20 +98,29 @@ void processMouseActiveMotion(GLint xMouse, GLint yMouse)
     circ.setRadius(radiusSlider.getValue());
   }
 
-  glutPostRedisplay();
+  // the evolvents only change with the slider values, a handle moving
+  // between two values redraws just itself
+  if (progress != progressSlider.getValue() ||
+      numbers != numbersSlider.getValue() ||
+      radius != radiusSlider.getValue())
+    Utils::Headless::postRedisplay();
+  else
+    Utils::Headless::postDamage();
 }
 
 int main(int argc, char **argv)
 {
-  glutInit(&argc, argv);
-  glutInitDisplayMode(GLUT_DOUBLE | GLUT_RGB);
-  glutInitWindowSize(WIDTH, HEIGHT);
-  glutCreateWindow("Homework 03");
+  Utils::Headless::createWindow(argc, argv, "Homework 03", WIDTH, HEIGHT);
 
   init();
-  glutDisplayFunc(display);
-  glutMouseFunc(processMouse);
-  glutMotionFunc(processMouseActiveMotion);
-  glutMainLoop();
-  return 0;
+  Utils::Headless::displayFunc(display);
+
+  // no input without a window
+  if (!Utils::Headless::active())
+  {
+    glutMouseFunc(processMouse);
+    glutMotionFunc(processMouseActiveMotion);
+  }
+
+  return Utils::Headless::mainLoop();
 }
@@ -5,6 +5,8 @@
 #include "Line.h"
 #include "Matrix.h"
 #include "Slider.h"
+#include "DisplayList.h"
+#include "Headless.h"
 
 // Typedefs -------------------------------------------------------------------
 typedef Utils::Point2D<GLdouble> Point2D;
@@ -58,6 +60,9 @@ Point2D notch1(sliderLine.pointAt(0.25));
 Point2D notch2(sliderLine.pointAt(0.5));
 Point2D notch3(sliderLine.pointAt(0.75));
 
+// Background grid ------------------------------------------------------------
+Utils::DisplayList<GLdouble> gridList;
+
 // Info text ------------------------------------------------------------------
 std::string tText;
 std::stringstream ss;
@@ -162,25 +167,31 @@ void init()
 void drawGrid(int width, int height, int gap, GLfloat lineWidth,
               const Utils::Color& color)
 {
-  color.setGLColor();
-  glLineWidth(lineWidth);
   glEnable(GL_LINE_STIPPLE);
   glLineStipple(1, 0xAAAA);
-  glBegin(GL_LINES);
 
-  for(int i = gap; i < width; i += gap)
+  // the grid never changes, its lines are built once
+  gridList.draw([&]()
   {
-    glVertex2i(i, 0);
-    glVertex2i(i, height);
-  }
+    color.setGLColor();
+    Utils::renderLineWidth(lineWidth);
+    Utils::renderBegin(GL_LINES);
 
-  for(int i = gap; i < height; i += gap)
-  {
-    glVertex2i(0, i);
-    glVertex2i(width, i);
-  }
+    for(int i = gap; i < width; i += gap)
+    {
+      Utils::renderVertex(i, 0);
+      Utils::renderVertex(i, height);
+    }
+
+    for(int i = gap; i < height; i += gap)
+    {
+      Utils::renderVertex(0, i);
+      Utils::renderVertex(width, i);
+    }
+
+    Utils::renderEnd();
+  });
 
-  glEnd();
   glDisable(GL_LINE_STIPPLE);
 }
 
@@ -193,8 +204,7 @@ void drawInfoText(GLint x, GLint y, const Utils::Color& color)
   ss.str("");
 
   color.setGLColor();
-  glRasterPos2i(x, y);
-  glutBitmapString(GLUT_BITMAP_HELVETICA_18, (unsigned char *)tText.c_str());
+  Utils::renderText(x, y, GLUT_BITMAP_HELVETICA_18, tText);
 }
 
 void display()
@@ -209,9 +219,9 @@ void display()
 
   // draw curve
   curveColor.setGLColor();
-  glLineWidth(lineWidth);
+  Utils::renderLineWidth(lineWidth);
 
-  glBegin(GL_LINE_STRIP);
+  Utils::renderBegin(GL_LINE_STRIP);
 
   // first curve segment
   Matrix C = G1 * M;
@@ -223,7 +233,7 @@ void display()
     T(2, 0) = t;
     T(3, 0) = 1;
     temp = C * T;
-    glVertex2d(temp(0, 0), temp(1, 0));
+    Utils::renderVertex(temp(0, 0), temp(1, 0));
   }
 
   // second curve segment
@@ -237,12 +247,12 @@ void display()
     T(2, 0) = t;
     T(3, 0) = 1;
     temp = C * T;
-    glVertex2d(temp(0, 0), temp(1, 0));
+    Utils::renderVertex(temp(0, 0), temp(1, 0));
   }
 
-  glVertex2d(P6.x(), P6.y());
+  Utils::renderVertex(P6.x(), P6.y());
 
-  glEnd();
+  Utils::renderEnd();
 
   // draw tangent line
   tangent.draw();
@@ -264,7 +274,7 @@ void display()
   t2Slider.drawHandle();
   t3Slider.drawHandle();
 
-  glutSwapBuffers();
+  Utils::Headless::swapBuffers();
 }
 
 void processMouse(GLint button, GLint action, GLint xMouse, GLint yMouse)
@@ -424,20 +434,22 @@ void processMouseActiveMotion(GLint xMouse, GLint yMouse)
     calcTangent2();
   }
 
-  glutPostRedisplay();
+  Utils::Headless::postRedisplay();
 }
 
 int main(int argc, char **argv)
 {
-  glutInit(&argc, argv);
-  glutInitDisplayMode(GLUT_DOUBLE | GLUT_RGB);
-  glutInitWindowSize(WIDTH, HEIGHT);
-  glutCreateWindow("Homework 04");
+  Utils::Headless::createWindow(argc, argv, "Homework 04", WIDTH, HEIGHT);
 
   init();
-  glutDisplayFunc(display);
-  glutMouseFunc(processMouse);
-  glutMotionFunc(processMouseActiveMotion);
-  glutMainLoop();
-  return 0;
+  Utils::Headless::displayFunc(display);
+
+  // no input without a window
+  if (!Utils::Headless::active())
+  {
+    glutMouseFunc(processMouse);
+    glutMotionFunc(processMouseActiveMotion);
+  }
+
+  return Utils::Headless::mainLoop();
 }
\ No newline at end of file
@@ -1,6 +1,8 @@
 #include <GL/glut.h>
 #include "Matrix.h"
 #include "PolyStar.h"
+#include "Headless.h"
+#include "FrameScheduler.h"
 
 // Typedefs -------------------------------------------------------------------
 typedef Utils::Matrix<GLdouble> Matrix;
@@ -19,7 +21,7 @@ const Utils::Color bgColor(Utils::WHITE);
 // Sizes ----------------------------------------------------------------------
 const GLfloat lineWidth = 2.0f;
 
-// Refresh rate ---------------------------------------------------------------
+// Animation step in ms -------------------------------------------------------
 const size_t refreshRate = 20;
 
 // Stars ----------------------------------------------------------------------
@@ -36,7 +38,7 @@ Scale2D scale2(1 / 0.99);
 Matrix T1(3, 3);
 Matrix T2(3, 3);
 
-// Frames of animation --------------------------------------------------------
+// Steps of animation ---------------------------------------------------------
 size_t frames = 0;
 
 void init()
@@ -59,19 +61,19 @@ void init()
 
 void display()
 {
-  frames++;
   glClear(GL_COLOR_BUFFER_BIT);
   star1.draw();
   star2.draw();
   star2.rc().draw();
-  glutSwapBuffers();
+  Utils::Headless::swapBuffers();
+}
 
+void appUpdate()
+{
+  frames++;
   star1.transform(T1);
   star2.transform(T2);
-}
 
-void appUpdate(int n)
-{
   if (frames == 90)
   {
     T1 = tr2 * rot1 * scale2 * tr1;
@@ -83,21 +85,14 @@ void appUpdate(int n)
     T2 = tr2 * rot2 * scale1 * tr1;
     frames = 0;
   }
-
-  glutPostRedisplay();
-  glutTimerFunc(refreshRate, appUpdate, 0);
 }
 
 int main(int argc, char **argv)
 {
-  glutInit(&argc, argv);
-  glutInitDisplayMode(GLUT_DOUBLE | GLUT_RGB);
-  glutInitWindowSize(WIDTH, HEIGHT);
-  glutCreateWindow("Homework 05");
+  Utils::Headless::createWindow(argc, argv, "Homework 05", WIDTH, HEIGHT);
 
   init();
-  glutDisplayFunc(display);
-  glutTimerFunc(refreshRate, appUpdate, 0);
-  glutMainLoop();
-  return 0;
+  Utils::Headless::displayFunc(display);
+  Utils::FrameScheduler::start(refreshRate, appUpdate);
+  return Utils::Headless::mainLoop();
 }
@@ -4,12 +4,7 @@
 #include "Line.h"
 #include "Circle.h"
 #include "PolyStar.h"
-
-#ifndef WIN32
-typedef GLvoid(*CallBack)();
-#else
-typedef GLvoid(_stdcall *CallBack)();
-#endif
+#include "Headless.h"
 
 // Typedefs -------------------------------------------------------------------
 typedef Utils::Point2D<GLdouble> Point2D;
@@ -43,17 +38,9 @@ Point2D *rightClicked = nullptr;
 std::vector<Polygon2D> polyVector;
 std::vector<Polygon2D> glassesVector;
 
-// Tessellator pointer --------------------------------------------------------
-GLUtesselator *tess;
-
-// Tessellator init and register callbacks
-void updateTess()
-{
-  tess = gluNewTess();
-  gluTessCallback(tess, GLU_TESS_BEGIN, (CallBack) glBegin);
-  gluTessCallback(tess, GLU_TESS_VERTEX, (CallBack) glVertex3dv);
-  gluTessCallback(tess, GLU_TESS_END, (CallBack) glEnd);
-}
+// Clipped polygons, one per polygon and glass. They keep their triangles
+// until the clipped outline changes.
+std::vector<Polygon2D> clippedVector;
 
 void init()
 {
@@ -140,40 +127,23 @@ void display()
   glDisable(GL_LINE_STIPPLE);
 
   // draw clipped polygons in glasses
+  clippedVector.resize(polyVector.size() * glassesVector.size());
+  size_t next = 0;
+
   for (const auto& p : polyVector)
   {
     for (const auto& glass : glassesVector)
     {
-      Polygon2D clipped = p.clipWith(glass);
-      p.color.setGLColor();
-      
-      // start tessellation
-      updateTess();
-      gluTessBeginPolygon(tess, NULL);
-
-      // construct temporary point container
-      std::vector<std::vector<GLdouble>> tempPoly;
-      size_t numofPoints = clipped.getPoints();
-      tempPoly.resize(numofPoints);
-
-      for (size_t i = 0; i < numofPoints; ++i)
-      {
-        tempPoly[i].emplace_back(clipped.pointsContainer[i].x());
-        tempPoly[i].emplace_back(clipped.pointsContainer[i].y());
-        tempPoly[i].emplace_back(0.0);
-      }
-
-      // give each point to the tessellator
-      for (size_t i = 0; i < tempPoly.size(); ++i)
-      {
-        gluTessVertex(tess, tempPoly[i].data(), tempPoly[i].data());
-      }
+      Polygon2D& clipped = clippedVector[next++];
+      clipped.setPoints(p.clipWith(glass).pointsContainer);
+      clipped.lineWidth = lineWidth;
 
-      // end tessellation
-      gluTessEndPolygon(tess);
+      // fill
+      clipped.filled = true;
+      clipped.drawWithOtherColor(p.color);
 
       // draw outline
-      clipped.lineWidth = lineWidth;
+      clipped.filled = false;
       clipped.draw();
     }
   }
@@ -192,12 +162,12 @@ void display()
   }
 
   // draw line between the 2 glasses
-  glBegin(GL_LINES);
+  Utils::renderBegin(GL_LINES);
   Utils::glVertex2<GLdouble>(glassesVector[0].pointsContainer[2]);
   Utils::glVertex2<GLdouble>(glassesVector[1].pointsContainer[0]);
-  glEnd();
+  Utils::renderEnd();
 
-  glutSwapBuffers();
+  Utils::Headless::swapBuffers();
 }
 
 void processMouse(GLint button, GLint action, GLint xMouse, GLint yMouse)
@@ -292,20 +262,23 @@ void processMouseActiveMotion(GLint xMouse, GLint yMouse)
     rightClicked->setXY(xMouse, HEIGHT - yMouse);
   }
 
-  glutPostRedisplay();
+  if (clicked || rightClicked)
+    Utils::Headless::postRedisplay();
 }
 
 int main(int argc, char **argv)
 {
-  glutInit(&argc, argv);
-  glutInitDisplayMode(GLUT_DOUBLE | GLUT_RGB);
-  glutInitWindowSize(WIDTH, HEIGHT);
-  glutCreateWindow("Homework 06");
+  Utils::Headless::createWindow(argc, argv, "Homework 06", WIDTH, HEIGHT);
 
   init();
-  glutDisplayFunc(display);
-  glutMouseFunc(processMouse);
-  glutMotionFunc(processMouseActiveMotion);
-  glutMainLoop();
-  return 0;
+  Utils::Headless::displayFunc(display);
+
+  // no input without a window
+  if (!Utils::Headless::active())
+  {
+    glutMouseFunc(processMouse);
+    glutMotionFunc(processMouseActiveMotion);
+  }
+
+  return Utils::Headless::mainLoop();
 }
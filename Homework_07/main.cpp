@@ -1,9 +1,11 @@
 #include <GL/freeglut.h>
-#include <sstream>
-#include <string>
+#include <cstdio>
 #include "Bezier2D.h"
 #include "Slider.h"
 #include "Vector2D.h"
+#include "DisplayList.h"
+#include "Headless.h"
+#include "TextAtlas.h"
 
 // ----------------------------------------------------------------------------
 // Typedefs
@@ -35,11 +37,16 @@ const int gridSize = 40;
 // ----------------------------------------------------------------------------
 Point2D *clicked = nullptr;
 
+// ----------------------------------------------------------------------------
+// Background grid
+// ----------------------------------------------------------------------------
+Utils::DisplayList<GLdouble> gridList;
+
 // ----------------------------------------------------------------------------
 // Info text
 // ----------------------------------------------------------------------------
-std::string tText;
-std::stringstream ss;
+char tText[128];
+Utils::TextLabel infoText(GLUT_BITMAP_HELVETICA_18);
 
 // ----------------------------------------------------------------------------
 // Curves
@@ -68,13 +75,11 @@ void init()
 // ----------------------------------------------------------------------------
 void drawInfoText(GLint x, GLint y, const Utils::Color& color)
 {
-  ss << "t: " << static_cast<double>(slider.getValue()) / 100 << std::endl;
-  tText = ss.str();
-  ss.str("");
+  std::snprintf(tText, sizeof(tText), "t: %g\n",
+                static_cast<double>(slider.getValue()) / 100);
 
   color.setGLColor();
-  glRasterPos2i(x, y);
-  glutBitmapString(GLUT_BITMAP_HELVETICA_18, (unsigned char *)tText.c_str());
+  infoText.draw(x, y, tText);
 }
 
 // ----------------------------------------------------------------------------
@@ -83,25 +88,31 @@ void drawInfoText(GLint x, GLint y, const Utils::Color& color)
 void drawGrid(int width, int height, int gap, GLfloat lineWidth,
               const Utils::Color& color)
 {
-  color.setGLColor();
-  glLineWidth(lineWidth);
   glEnable(GL_LINE_STIPPLE);
   glLineStipple(1, 0xAAAA);
-  glBegin(GL_LINES);
 
-  for (int i = gap; i < width; i += gap)
+  // the grid never changes, its lines are built once
+  gridList.draw([&]()
   {
-    glVertex2i(i, 0);
-    glVertex2i(i, height);
-  }
+    color.setGLColor();
+    Utils::renderLineWidth(lineWidth);
+    Utils::renderBegin(GL_LINES);
 
-  for (int i = gap; i < height; i += gap)
-  {
-    glVertex2i(0, i);
-    glVertex2i(width, i);
-  }
+    for (int i = gap; i < width; i += gap)
+    {
+      Utils::renderVertex(i, 0);
+      Utils::renderVertex(i, height);
+    }
+
+    for (int i = gap; i < height; i += gap)
+    {
+      Utils::renderVertex(0, i);
+      Utils::renderVertex(width, i);
+    }
+
+    Utils::renderEnd();
+  });
 
-  glEnd();
   glDisable(GL_LINE_STIPPLE);
 }
 
@@ -110,6 +121,7 @@ void drawGrid(int width, int height, int gap, GLfloat lineWidth,
 // ----------------------------------------------------------------------------
 void display()
 {
+  Utils::Damage::beginFrame();
   glClear(GL_COLOR_BUFFER_BIT);
 
   // draw grid to into background
@@ -132,7 +144,8 @@ void display()
   // draw slider
   slider.draw();
 
-  glutSwapBuffers();
+  Utils::Damage::endFrame();
+  Utils::Headless::swapBuffers();
 }
 
 // ----------------------------------------------------------------------------
@@ -251,7 +264,7 @@ void processMouse(GLint button, GLint action, GLint xMouse, GLint yMouse)
     }
   }
 
-  glutPostRedisplay();
+  Utils::Headless::postRedisplay();
 }
 
 // ----------------------------------------------------------------------------
@@ -298,28 +311,36 @@ void processMouseActiveMotion(GLint xMouse, GLint yMouse)
       // handle clicked point on second curve
       b2.handleClick(xMouse, HEIGHT - yMouse, clicked);
 
-    glutPostRedisplay();
+    Utils::Headless::postRedisplay();
   }
 
   // handle slider
   if (slider.isDragging())
   {
+    int t = slider.getValue();
     slider.setHandlePos(xMouse);
-    glutPostRedisplay();
+
+    // the interpolation only changes with the slider value
+    if (t != slider.getValue())
+      Utils::Headless::postRedisplay();
+    else
+      Utils::Headless::postDamage();
   }
 }
 
 int main(int argc, char **argv)
 {
-  glutInit(&argc, argv);
-  glutInitDisplayMode(GLUT_DOUBLE | GLUT_RGB);
-  glutInitWindowSize(WIDTH, HEIGHT);
-  glutCreateWindow("Homework 07");
+  Utils::Headless::createWindow(argc, argv, "Homework 07", WIDTH, HEIGHT);
 
   init();
-  glutDisplayFunc(display);
-  glutMouseFunc(processMouse);
-  glutMotionFunc(processMouseActiveMotion);
-  glutMainLoop();
-  return 0;
+  Utils::Headless::displayFunc(display);
+
+  // no input without a window
+  if (!Utils::Headless::active())
+  {
+    glutMouseFunc(processMouse);
+    glutMotionFunc(processMouseActiveMotion);
+  }
+
+  return Utils::Headless::mainLoop();
 }
@@ -1,9 +1,11 @@
 #include <GL/freeglut.h>
-#include <sstream>
-#include <string>
+#include <cstdio>
 #include "Rectangle.h"
 #include "Cube.h"
 #include "Vector2D.h"
+#include "DisplayList.h"
+#include "Headless.h"
+#include "TextAtlas.h"
 
 // ----------------------------------------------------------------------------
 // Typedefs
@@ -55,11 +57,24 @@ WTV wtv2(window, viewport2);
 Rotate3DX rx(0);
 Rotate3DY ry(0);
 
+// ----------------------------------------------------------------------------
+// Clipping before the perspective divide, to the near plane and the viewport
+// of each view
+// ----------------------------------------------------------------------------
+Utils::ClipVolume<GLdouble> clipVolume1;
+Utils::ClipVolume<GLdouble> clipVolume2;
+
+// ----------------------------------------------------------------------------
+// Grid floor of both views
+// ----------------------------------------------------------------------------
+Utils::DisplayList<GLdouble> gridList1;
+Utils::DisplayList<GLdouble> gridList2;
+
 // ----------------------------------------------------------------------------
 // Info text
 // ----------------------------------------------------------------------------
-std::string tText;
-std::stringstream ss;
+char tText[128];
+Utils::TextLabel infoText(GLUT_BITMAP_HELVETICA_18);
 
 // ----------------------------------------------------------------------------
 // The cube
@@ -89,6 +104,9 @@ void init()
   glEnable(GL_POINT_SMOOTH);
   glEnable(GL_BLEND);
   glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+  clipVolume1.setBounds(viewport1);
+  clipVolume2.setBounds(viewport2);
 }
 
 // ----------------------------------------------------------------------------
@@ -96,44 +114,54 @@ void init()
 // ----------------------------------------------------------------------------
 void drawInfoText(GLint x, GLint y, const Utils::Color& color)
 {
-  ss << "s: " << cp.getDistanceToOrigin() << std::endl;
-  tText = ss.str();
-  ss.str("");
+  std::snprintf(tText, sizeof(tText), "s: %g\n", cp.getDistanceToOrigin());
 
   color.setGLColor();
-  glRasterPos2i(x, y);
-  glutBitmapString(GLUT_BITMAP_HELVETICA_18, (unsigned char *)tText.c_str());
+  infoText.draw(x, y, tText);
 }
 
 // ----------------------------------------------------------------------------
 // Draw grid floor
 // ----------------------------------------------------------------------------
 void drawGrid(double start, double end, double gap, GLfloat lineWidth,
-              const Utils::Color& color, const Utils::Matrix<GLdouble>& mat)
+              const Utils::Color& color, const Utils::Matrix<GLdouble>& mat,
+              const Utils::ClipVolume<GLdouble>& clipVolume,
+              Utils::DisplayList<GLdouble>& list)
 {
-  color.setGLColor();
-  glLineWidth(lineWidth);
   glEnable(GL_LINE_STIPPLE);
   glLineStipple(1, 0xAAAA);
-  glBegin(GL_LINES);
 
-  for (double i = start; i <= end; i += gap)
+  // lines are transformed and clipped again only when the view changes
+  list.draw(mat, [&]()
   {
-    Utils::Point3DH<GLdouble> asd1(i, -0.5, end);
-    Utils::glVertex2<GLdouble>(asd1.transformed(mat).normalized2D());
-    Utils::Point3DH<GLdouble> asd2(i, -0.5, start);
-    Utils::glVertex2<GLdouble>(asd2.transformed(mat).normalized2D());
-  }
-
-  for (double i = start; i <= end; i += gap)
-  {
-    Utils::Point3DH<GLdouble> asd1(start, -0.5, i);
-    Utils::glVertex2<GLdouble>(asd1.transformed(mat).normalized2D());
-    Utils::Point3DH<GLdouble> asd2(end, -0.5, i);
-    Utils::glVertex2<GLdouble>(asd2.transformed(mat).normalized2D());
-  }
+    color.setGLColor();
+    Utils::renderLineWidth(lineWidth);
+    Utils::renderBegin(GL_LINES);
+
+    auto drawLine = [&](const Utils::Point3DH<GLdouble>& p1,
+                        const Utils::Point3DH<GLdouble>& p2)
+    {
+      auto a = p1.transformed(mat);
+      auto b = p2.transformed(mat);
+
+      if (clipVolume.clipLine(a, b))
+      {
+        Utils::glVertex2<GLdouble>(a.normalized2D());
+        Utils::glVertex2<GLdouble>(b.normalized2D());
+      }
+    };
+
+    for (double i = start; i <= end; i += gap)
+      drawLine(Utils::Point3DH<GLdouble>(i, -0.5, end),
+               Utils::Point3DH<GLdouble>(i, -0.5, start));
+
+    for (double i = start; i <= end; i += gap)
+      drawLine(Utils::Point3DH<GLdouble>(start, -0.5, i),
+               Utils::Point3DH<GLdouble>(end, -0.5, i));
+
+    Utils::renderEnd();
+  });
 
-  glEnd();
   glDisable(GL_LINE_STIPPLE);
 }
 
@@ -152,27 +180,31 @@ void display()
   auto m2 = projTrans2 * rxry;
 
   // draw grid floor
-  drawGrid(-0.7, 0.7, 0.1, lineWidth, Utils::VERY_LIGHT_GRAY, m1);
-  drawGrid(-0.7, 0.7, 0.1, lineWidth, Utils::VERY_LIGHT_GRAY, m2);
+  drawGrid(-0.7, 0.7, 0.1, lineWidth, Utils::VERY_LIGHT_GRAY, m1, clipVolume1,
+           gridList1);
+  drawGrid(-0.7, 0.7, 0.1, lineWidth, Utils::VERY_LIGHT_GRAY, m2, clipVolume2,
+           gridList2);
 
   // draw info text
   drawInfoText(WIDTH - 60, HEIGHT - 30, Utils::BLACK);
 
-  // draw cube(s)
+  // draw cube(s), clipped to the viewport of each view
+  cube.clipper = clipVolume1;
   cube.drawEdges(m1);
   cube.drawPoints(m1);
+  cube.clipper = clipVolume2;
   cube.drawEdges(m2);
   cube.drawPoints(m2);
 
   if (drag)
   {
-    glBegin(GL_LINES);
-    glVertex2i(clickedX, clickedY);
-    glVertex2i(draggedX, draggedY);
-    glEnd();
+    Utils::renderBegin(GL_LINES);
+    Utils::renderVertex(clickedX, clickedY);
+    Utils::renderVertex(draggedX, draggedY);
+    Utils::renderEnd();
   }
 
-  glutSwapBuffers();
+  Utils::Headless::swapBuffers();
 }
 
 // ----------------------------------------------------------------------------
@@ -197,7 +229,7 @@ void processMouse(GLint button, GLint action, GLint xMouse, GLint yMouse)
     lastRotX = rx.getAngle();
     lastRotY = ry.getAngle();
 
-    glutPostRedisplay();
+    Utils::Headless::postRedisplay();
   }
 }
 
@@ -218,7 +250,7 @@ void processMouseActiveMotion(GLint xMouse, GLint yMouse)
     draggedY = clickedY + v.y();
   }
 
-  glutPostRedisplay();
+  Utils::Headless::postRedisplay();
 }
 
 // ----------------------------------------------------------------------------
@@ -228,7 +260,7 @@ void wheelFunc(int wheel, int direction, int x, int y)
 {
   auto value = cp.getDistanceToOrigin();
   cp.setDistanceToOrigin(value + direction * 0.1);
-  glutPostRedisplay();
+  Utils::Headless::postRedisplay();
 }
 
 // ----------------------------------------------------------------------------
@@ -236,16 +268,18 @@ void wheelFunc(int wheel, int direction, int x, int y)
 // ----------------------------------------------------------------------------
 int main(int argc, char **argv)
 {
-  glutInit(&argc, argv);
-  glutInitDisplayMode(GLUT_DOUBLE | GLUT_RGB);
-  glutInitWindowSize(WIDTH, HEIGHT);
-  glutCreateWindow("Homework 08");
+  Utils::Headless::createWindow(argc, argv, "Homework 08", WIDTH, HEIGHT);
 
   init();
-  glutDisplayFunc(display);
-  glutMouseFunc(processMouse);
-  glutMotionFunc(processMouseActiveMotion);
-  glutMouseWheelFunc(wheelFunc);
-  glutMainLoop();
-  return 0;
+  Utils::Headless::displayFunc(display);
+
+  // no input without a window
+  if (!Utils::Headless::active())
+  {
+    glutMouseFunc(processMouse);
+    glutMotionFunc(processMouseActiveMotion);
+    glutMouseWheelFunc(wheelFunc);
+  }
+
+  return Utils::Headless::mainLoop();
 }
@@ -1,10 +1,13 @@
 #include <GL/freeglut.h>
-#include <sstream>
-#include <string>
+#include <cstdio>
 #include "Rectangle.h"
 #include "Matrix.h"
 #include "Point2D.h"
 #include "Point3D.h"
+#include "DisplayList.h"
+#include "Headless.h"
+#include "FrameScheduler.h"
+#include "TextAtlas.h"
 
 // ----------------------------------------------------------------------------
 // Typedefs
@@ -29,7 +32,7 @@ const Utils::Color graphColor(Utils::ORANGE);
 const Utils::Color graphGridColor(Utils::BLACK);
 
 // ----------------------------------------------------------------------------
-// Refresh rate
+// Animation step in ms
 // ----------------------------------------------------------------------------
 const size_t refreshRate = 10;
 
@@ -66,11 +69,16 @@ WTV wtv1(window, viewport);
 CvP cvp(Utils::degToRad(projAngle));
 auto T = wtv1 * cvp;
 
+// ----------------------------------------------------------------------------
+// Grid floor
+// ----------------------------------------------------------------------------
+Utils::DisplayList<GLdouble> gridList;
+
 // ----------------------------------------------------------------------------
 // Info text
 // ----------------------------------------------------------------------------
-std::string tText;
-std::stringstream ss;
+char tText[128];
+Utils::TextLabel infoText(GLUT_BITMAP_HELVETICA_18);
 
 // ----------------------------------------------------------------------------
 // FPS counter variables
@@ -89,27 +97,15 @@ Point3DH f(double x, double y, double p)
 }
 
 // ----------------------------------------------------------------------------
-// Init function
+// Project the function at phase p
 // ----------------------------------------------------------------------------
-void init()
+void updateGraph(double p)
 {
-  bgColor.setGLClearColor();
-  glMatrixMode(GL_PROJECTION);
-  gluOrtho2D(0.0, WIDTH, 0.0, HEIGHT);
-  glEnable(GL_LINE_SMOOTH);
-  glEnable(GL_POINT_SMOOTH);
-  glEnable(GL_BLEND);
-  glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-
-  // Allocate memory for graph points
   size_t i = 0;
-  size_t j = 0;
-
-  graph = new Point2D*[points];
+  size_t j;
 
   for (double x = xMin; x < xMax; x += step)
   {
-    graph[i] = new Point2D[points];
     j = 0;
 
     for (double y = yMin; y < yMax; y += step)
@@ -122,19 +118,36 @@ void init()
   }
 }
 
+// ----------------------------------------------------------------------------
+// Init function
+// ----------------------------------------------------------------------------
+void init()
+{
+  bgColor.setGLClearColor();
+  glMatrixMode(GL_PROJECTION);
+  gluOrtho2D(0.0, WIDTH, 0.0, HEIGHT);
+  glEnable(GL_LINE_SMOOTH);
+  glEnable(GL_POINT_SMOOTH);
+  glEnable(GL_BLEND);
+  glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+  // Allocate memory for graph points
+  graph = new Point2D*[points];
+
+  for (size_t i = 0; i < points; i++)
+    graph[i] = new Point2D[points];
+}
+
 // ----------------------------------------------------------------------------
 // Info text function. Shows current value of projection angle and FPS
 // ----------------------------------------------------------------------------
 void drawInfoText(GLint x, GLint y, const Utils::Color& color)
 {
-  ss << "Projection angle: " << projAngle << " degrees" << std::endl;
-  ss << "FPS: " << fps << std::endl;
-  tText = ss.str();
-  ss.str("");
+  std::snprintf(tText, sizeof(tText),
+                "Projection angle: %g degrees\nFPS: %g\n", projAngle, fps);
 
   color.setGLColor();
-  glRasterPos2i(x, y);
-  glutBitmapString(GLUT_BITMAP_HELVETICA_18, (unsigned char *)tText.c_str());
+  infoText.draw(x, y, tText);
 }
 
 // ----------------------------------------------------------------------------
@@ -143,37 +156,75 @@ void drawInfoText(GLint x, GLint y, const Utils::Color& color)
 void drawGrid(double start, double end, double gap, GLfloat lineWidth,
               const Utils::Color& color, const Utils::Matrix<GLdouble>& mat)
 {
-  color.setGLColor();
-  glLineWidth(lineWidth);
   glEnable(GL_LINE_STIPPLE);
   glLineStipple(1, 0xAAAA);
-  glBegin(GL_LINES);
 
-  for (double i = start; i <= end; i += gap)
+  // lines are transformed again only when the projection changes
+  gridList.draw(mat, [&]()
   {
-    Utils::Point3DH<GLdouble> asd1(i, end, -2);
-    Utils::glVertex2<GLdouble>(asd1.transformed(mat).normalized2D());
-    Utils::Point3DH<GLdouble> asd2(i, start, -2);
-    Utils::glVertex2<GLdouble>(asd2.transformed(mat).normalized2D());
-  }
+    color.setGLColor();
+    Utils::renderLineWidth(lineWidth);
+    Utils::renderBegin(GL_LINES);
 
-  for (double i = start; i <= end; i += gap)
-  {
-    Utils::Point3DH<GLdouble> asd1(start, i, -2);
-    Utils::glVertex2<GLdouble>(asd1.transformed(mat).normalized2D());
-    Utils::Point3DH<GLdouble> asd2(end, i, -2);
-    Utils::glVertex2<GLdouble>(asd2.transformed(mat).normalized2D());
-  }
+    for (double i = start; i <= end; i += gap)
+    {
+      Utils::Point3DH<GLdouble> asd1(i, end, -2);
+      Utils::glVertex2<GLdouble>(asd1.transformed(mat).normalized2D());
+      Utils::Point3DH<GLdouble> asd2(i, start, -2);
+      Utils::glVertex2<GLdouble>(asd2.transformed(mat).normalized2D());
+    }
+
+    for (double i = start; i <= end; i += gap)
+    {
+      Utils::Point3DH<GLdouble> asd1(start, i, -2);
+      Utils::glVertex2<GLdouble>(asd1.transformed(mat).normalized2D());
+      Utils::Point3DH<GLdouble> asd2(end, i, -2);
+      Utils::glVertex2<GLdouble>(asd2.transformed(mat).normalized2D());
+    }
+
+    Utils::renderEnd();
+  });
 
-  glEnd();
   glDisable(GL_LINE_STIPPLE);
 }
 
+// ----------------------------------------------------------------------------
+// FPS counter
+// ----------------------------------------------------------------------------
+void countFrame()
+{
+  //  Increase frame count
+  frameCount++;
+
+  //  Get the number of milliseconds since glutInit called
+  //  (or first call to glutGet(GLUT ELAPSED TIME)).
+  currentTime = Utils::Headless::elapsedTime();
+
+  //  Calculate time passed
+  int timeInterval = currentTime - previousTime;
+
+  if (timeInterval > 1000)
+  {
+    //  calculate the number of frames per second
+    fps = frameCount / (timeInterval / 1000.0f);
+
+    //  Set time
+    previousTime = currentTime;
+
+    //  Reset frame count
+    frameCount = 0;
+  }
+}
+
 // ----------------------------------------------------------------------------
 // Main display function
 // ----------------------------------------------------------------------------
 void display()
 {
+  // the phase moves by 0.1 every step, draw it in between steps
+  updateGraph(p - 0.1 * Utils::FrameScheduler::alpha());
+  countFrame();
+
   glClear(GL_COLOR_BUFFER_BIT);
 
   drawInfoText(10, HEIGHT - 24, Utils::BLACK);
@@ -188,48 +239,49 @@ void display()
       auto Xval = static_cast<GLfloat>(xMin + row * (xMax - xMin)) / points;
       auto Yval = static_cast<GLfloat>(yMin + col * (yMax - yMin)) / points;
 
-      glColor3f(static_cast<GLfloat>(Xval * 0.02),
-                static_cast<GLfloat>(Yval * 0.02), 0.9f);
+      Utils::renderColor3f(static_cast<GLfloat>(Xval * 0.02),
+                           static_cast<GLfloat>(Yval * 0.02), 0.9f);
 
-      glBegin(GL_POLYGON);
-      glVertex2d(graph[row][col].x(), graph[row][col].y());
-      glVertex2d(graph[row][col + 1].x(), graph[row][col + 1].y());
-      glVertex2d(graph[row + 1][col + 1].x(), graph[row + 1][col + 1].y());
-      glVertex2d(graph[row + 1][col].x(), graph[row + 1][col].y());
-      glEnd();
+      Utils::renderBegin(GL_POLYGON);
+      Utils::renderVertex(graph[row][col].x(), graph[row][col].y());
+      Utils::renderVertex(graph[row][col + 1].x(), graph[row][col + 1].y());
+      Utils::renderVertex(graph[row + 1][col + 1].x(),
+                          graph[row + 1][col + 1].y());
+      Utils::renderVertex(graph[row + 1][col].x(), graph[row + 1][col].y());
+      Utils::renderEnd();
     }
 
     // draw horizontal lines
     graphGridColor.setGLColor();
 
-    glBegin(GL_LINE_STRIP);
+    Utils::renderBegin(GL_LINE_STRIP);
 
     for (size_t col = 0; col < points; col++)
-      glVertex2d(graph[row][col].x(), graph[row][col].y());
+      Utils::renderVertex(graph[row][col].x(), graph[row][col].y());
 
-    glEnd();
+    Utils::renderEnd();
 
     // draw vertical lines
-    glBegin(GL_LINES);
+    Utils::renderBegin(GL_LINES);
 
     for (size_t col = 0; col < points; col++)
     {
-      glVertex2d(graph[row][col].x(), graph[row][col].y());
-      glVertex2d(graph[row + 1][col].x(), graph[row + 1][col].y());
+      Utils::renderVertex(graph[row][col].x(), graph[row][col].y());
+      Utils::renderVertex(graph[row + 1][col].x(), graph[row + 1][col].y());
     }
 
-    glEnd();
+    Utils::renderEnd();
   }
 
   // draw last horizontal line
-  glBegin(GL_LINE_STRIP);
+  Utils::renderBegin(GL_LINE_STRIP);
 
   for (size_t col = 0; col < points; col++)
-    glVertex2d(graph[79][col].x(), graph[79][col].y());
+    Utils::renderVertex(graph[79][col].x(), graph[79][col].y());
 
-  glEnd();
+  Utils::renderEnd();
 
-  glutSwapBuffers();
+  Utils::Headless::swapBuffers();
 }
 
 void keyPressed(int key, int x, int y)
@@ -261,46 +313,6 @@ void appUpdate()
 
   if (p < (-2 * Utils::PI))
     p = 0.0;
-
-  size_t i = 0;
-  size_t j;
-
-  for (double x = xMin; x < xMax; x += step)
-  {
-    j = 0;
-
-    for (double y = yMin; y < yMax; y += step)
-    {
-      graph[i][j] = f(x, y, p).transformed(T).normalized2D();
-      j++;
-    }
-
-    i++;
-  }
-
-  //  Increase frame count
-  frameCount++;
-
-  //  Get the number of milliseconds since glutInit called
-  //  (or first call to glutGet(GLUT ELAPSED TIME)).
-  currentTime = glutGet(GLUT_ELAPSED_TIME);
-
-  //  Calculate time passed
-  int timeInterval = currentTime - previousTime;
-
-  if (timeInterval > 1000)
-  {
-    //  calculate the number of frames per second
-    fps = frameCount / (timeInterval / 1000.0f);
-
-    //  Set time
-    previousTime = currentTime;
-
-    //  Reset frame count
-    frameCount = 0;
-  }
-
-  glutPostRedisplay();
 }
 
 void cleanup()
@@ -316,16 +328,16 @@ void cleanup()
 // ----------------------------------------------------------------------------
 int main(int argc, char **argv)
 {
-  glutInit(&argc, argv);
-  glutInitDisplayMode(GLUT_DOUBLE | GLUT_RGB);
-  glutInitWindowSize(WIDTH, HEIGHT);
-  glutCreateWindow("Homework 09");
+  Utils::Headless::createWindow(argc, argv, "Homework 09", WIDTH, HEIGHT);
 
   init();
-  glutDisplayFunc(display);
-  glutSpecialFunc(keyPressed);
-  glutIdleFunc(appUpdate);
-  glutCloseFunc(cleanup);
-  glutMainLoop();
-  return 0;
+  Utils::Headless::displayFunc(display);
+
+  // no input without a window
+  if (!Utils::Headless::active())
+    glutSpecialFunc(keyPressed);
+
+  Utils::FrameScheduler::start(refreshRate, appUpdate);
+  Utils::Headless::closeFunc(cleanup);
+  return Utils::Headless::mainLoop();
 }
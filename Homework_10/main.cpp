@@ -1,7 +1,10 @@
 #include <GL/freeglut.h>
-#include <sstream>
+#include <algorithm>
+#include <cstdarg>
+#include <cstdio>
 #include <string>
 #include <memory>
+#include <iostream>
 #include "Rectangle.h"
 #include "Matrix.h"
 #include "Point3D.h"
@@ -9,7 +12,13 @@
 #include "Vector2D.h"
 #include "Sphere.h"
 #include "Torus.h"
+#include "MeshInstances.h"
+#include "MeshLOD.h"
+#include "BVH.h"
+#include "Model.h"
 #include "Button.h"
+#include "Headless.h"
+#include "TextAtlas.h"
 
 // ----------------------------------------------------------------------------
 // Window size
@@ -60,12 +69,14 @@ Utils::Point3DH<GLdouble> lightSource(2, 2, 8, 1);
 // ----------------------------------------------------------------------------
 // Info text
 // ----------------------------------------------------------------------------
-std::string tText;
-std::stringstream ss;
+char tText[512];
+size_t tLength = 0;
+Utils::TextLabel infoText(GLUT_BITMAP_HELVETICA_18);
 
 // ----------------------------------------------------------------------------
 // Buttons
 // ----------------------------------------------------------------------------
+Utils::Button smoothButton("Smooth", 16, 256, 156, 32);
 Utils::Button normalsButton("Normals", 16, 208, 156, 32);
 Utils::Button pointsButton("Points", 16, 160, 156, 32);
 Utils::Button shadingButton("Shading", 16, 112, 156, 32);
@@ -81,6 +92,28 @@ std::shared_ptr<Utils::Mesh<GLdouble>> activeObject;
 std::vector<std::shared_ptr<Utils::Mesh<GLdouble>>> objects;
 auto objIterator = objects.begin();
 
+// optional OBJ/PLY model given on the command line
+std::string modelPath;
+std::shared_ptr<Utils::MeshLOD<GLdouble>> modelLOD;
+
+// face hierarchy of the model, queried for the faces inside the viewport
+std::shared_ptr<Utils::BVH<GLdouble>> modelBVH;
+std::vector<size_t> facesInView;
+
+// everything is clipped to the near plane and the viewport
+Utils::ClipVolume<GLdouble> viewVolume;
+
+// block of small spheres sharing one geometry, toggled with 'i', with
+// occlusion culling toggled by 'o'
+Utils::MeshInstances<GLdouble> instances(
+  std::make_shared<Utils::Sphere<GLdouble>>(12));
+auto occlusion = std::make_shared<Utils::HiZBuffer<GLdouble>>(viewport);
+bool showInstances = false;
+
+// objects are recorded each frame and replayed from vertex arrays
+Utils::CommandBuffer frame;
+Utils::GLVertexArrayBackend frameBackend;
+
 // ----------------------------------------------------------------------------
 // Init function
 // ----------------------------------------------------------------------------
@@ -93,18 +126,103 @@ void init()
   glEnable(GL_POINT_SMOOTH);
   glEnable(GL_BLEND);
   glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+  viewVolume.setBounds(viewport);
 
   objects.emplace_back(new Utils::Sphere<GLdouble>());
   objects.back()->pointSize = 6.0f;
   objects.back()->normalColor = normalColor;
   objects.back()->pointColor = pointColor;
   objects.back()->edgeColor = edgeColor;
+  objects.back()->clipper = viewVolume;
 
   objects.emplace_back(new Utils::Torus<GLdouble>());
   objects.back()->pointSize = 6.0f;
   objects.back()->normalColor = normalColor;
   objects.back()->pointColor = pointColor;
   objects.back()->edgeColor = edgeColor;
+  objects.back()->clipper = viewVolume;
+
+  // reorder faces for the post-transform cache, also after segment changes
+  for (auto& object : objects)
+  {
+    object->optimizeFaceOrder();
+    object->cacheOptimized = true;
+  }
+
+  if (!modelPath.empty())
+  {
+    auto model = std::make_shared<Utils::Model<GLdouble>>();
+
+    // parse the source file only once, later runs map the binary cache
+    // until the source changes
+    std::string cachePath = modelPath + ".bgmc";
+    bool loaded = model->loadCache(cachePath, modelPath);
+
+    if (!loaded && (loaded = model->load(modelPath)))
+    {
+      model->fitToUnitSphere();
+
+      // the cache stores the optimized order, so this runs once per file
+      model->sortVerticesMorton();
+      model->optimizeFaceOrder();
+
+      model->saveCache(cachePath, modelPath);
+    }
+
+    if (loaded)
+    {
+      std::cout << modelPath << ": " << model->getVertexCount()
+                << " vertices, " << model->faces.size() << " faces, "
+                << model->getLoadSeconds() * 1000 << " ms, "
+                << model->getThroughput() << " MB/s" << std::endl;
+
+      objects.emplace_back(model);
+      objects.back()->pointSize = 6.0f;
+      objects.back()->normalColor = normalColor;
+      objects.back()->pointColor = pointColor;
+      objects.back()->edgeColor = edgeColor;
+      objects.back()->clipper = viewVolume;
+
+      modelLOD = std::make_shared<Utils::MeshLOD<GLdouble>>(model);
+      std::cout << modelLOD->levels.size() << " levels of detail, coarsest "
+                << modelLOD->levels.back()->faces.size() << " faces"
+                << std::endl;
+
+      modelBVH = std::make_shared<Utils::BVH<GLdouble>>(*model);
+    }
+    else
+    {
+      std::cerr << "Could not load model: " << modelPath << std::endl;
+    }
+  }
+
+  smoothButton.setPaddingX(50);
+  const int gridSize = 6;
+  const Utils::Color palette[] =
+  {
+    Utils::RED, Utils::GREEN, Utils::BLUE, Utils::YELLOW
+  };
+
+  for (int i = 0; i < gridSize; ++i)
+  {
+    for (int j = 0; j < gridSize; ++j)
+    {
+      for (int k = 0; k < gridSize; ++k)
+      {
+        GLdouble x = -1.0 + 2.0 * i / (gridSize - 1);
+        GLdouble y = -1.0 + 2.0 * j / (gridSize - 1);
+        GLdouble z = -1.0 + 2.0 * k / (gridSize - 1);
+        instances.add(Utils::Translate3D<GLdouble>(x, y, z) *
+                      Utils::Scale3D<GLdouble>(0.25),
+                      palette[(i + j + k) % 4]);
+      }
+    }
+  }
+
+  instances.occluderCount = gridSize * gridSize;
+
+  instances.edgeColor = edgeColor;
+  instances.clipper = viewVolume;
 
   normalsButton.setPaddingX(46);
   pointsButton.setPaddingX(52);
@@ -117,25 +235,62 @@ void init()
   objectsButton.setLabel(activeObject->label);
 }
 
+// ----------------------------------------------------------------------------
+// Append formatted text to the info text, truncated at the end of its buffer
+// ----------------------------------------------------------------------------
+void appendInfoText(const char *format, ...)
+{
+  va_list args;
+  va_start(args, format);
+  int written = std::vsnprintf(tText + tLength, sizeof(tText) - tLength,
+                               format, args);
+  va_end(args);
+
+  if (written > 0)
+    tLength = std::min(tLength + written, sizeof(tText) - 1);
+}
+
 // ----------------------------------------------------------------------------
 // Shows current value of projection distance and number of segments
 // ----------------------------------------------------------------------------
 void drawInfoText(GLint x, GLint y, const Utils::Color& color)
 {
-  ss << "Projection distance: " << cp.getDistanceToOrigin() << std::endl;
-  ss << "Segments: " << activeObject->getSegments() << std::endl;
-
-  if (activeObject->backfaceCull)
-    ss << "Backface culling: " << "on" << std::endl;
-  else
-    ss << "Backface culling: " << "off" << std::endl;
+  tLength = 0;
+  tText[0] = '\0';
+
+  appendInfoText("Projection distance: %g\nSegments: %zu\n",
+                 cp.getDistanceToOrigin(), activeObject->getSegments());
+  appendInfoText("Backface culling: %s\n",
+                 activeObject->backfaceCull ? "on" : "off");
+  appendInfoText("Vertex transforms: %zu (%zu cached)\n",
+                 activeObject->getTransformMisses(),
+                 activeObject->getTransformHits());
+  appendInfoText("Draw calls: %zu for %zu commands\n",
+                 frameBackend.getDrawCalls(), frame.commands.size());
+
+  if (showInstances)
+  {
+    appendInfoText("Instances: %zu of %zu drawn\n",
+                   instances.getDrawnInstances(), instances.size());
 
-  tText = ss.str();
-  ss.str("");
+    if (instances.occlusion)
+      appendInfoText("Occluded: %zu objects, %zu faces\n",
+                     occlusion->culledObjects, occlusion->culledFaces);
+  }
+  else if (modelLOD && activeObject == modelLOD->levels.front())
+  {
+    size_t level = modelLOD->selectLevel(rxry, cp, wtv);
+    appendInfoText("Level of detail: %zu (%zu faces)\n", level,
+                   modelLOD->levels[level]->faces.size());
+
+    auto planes = Utils::BVH<GLdouble>::frustumPlanes(projTrans * rxry,
+                                                      viewVolume);
+    modelBVH->queryFrustum(planes, facesInView);
+    appendInfoText("Faces in view: %zu\n", facesInView.size());
+  }
 
   color.setGLColor();
-  glRasterPos2i(x, y);
-  glutBitmapString(GLUT_BITMAP_HELVETICA_18, (unsigned char *)tText.c_str());
+  infoText.draw(x, y, tText);
 }
 
 // ----------------------------------------------------------------------------
@@ -143,13 +298,37 @@ void drawInfoText(GLint x, GLint y, const Utils::Color& color)
 // ----------------------------------------------------------------------------
 void display()
 {
+  Utils::Damage::beginFrame();
   glClear(GL_COLOR_BUFFER_BIT);
 
   drawInfoText(10, HEIGHT - 24, Utils::BLACK);
 
-  activeObject->drawFaces(projTrans, rxry, centerofProjection, lightSource);
+  frame.clear();
+  frame.record();
+
+  if (showInstances)
+  {
+    instances.backfaceCull = activeObject->backfaceCull;
+    instances.drawEdges = activeObject->drawEdges;
+    instances.draw(projTrans, rxry, centerofProjection, lightSource);
+  }
+  else if (modelLOD && activeObject == modelLOD->levels.front())
+  {
+    // buttons toggle the original, the levels follow its settings
+    modelLOD->syncSettings();
+    modelLOD->select(rxry, cp, wtv).drawFaces(projTrans, rxry,
+        centerofProjection, lightSource);
+  }
+  else
+  {
+    activeObject->drawFaces(projTrans, rxry, centerofProjection, lightSource);
+  }
+
+  frame.stop();
+  frame.replay(frameBackend);
 
   edgesButton.draw();
+  smoothButton.draw();
   normalsButton.draw();
   pointsButton.draw();
   cullButton.draw();
@@ -157,7 +336,8 @@ void display()
 
   objectsButton.draw();
 
-  glutSwapBuffers();
+  Utils::Damage::endFrame();
+  Utils::Headless::swapBuffers();
 }
 
 // ----------------------------------------------------------------------------
@@ -180,6 +360,13 @@ void processMouse(GLint button, GLint action, GLint xMouse, GLint yMouse)
       activeObject->drawEdges = false : activeObject->drawEdges = true;
     }
 
+    if (smoothButton.hover(xMouse, HEIGHT - yMouse))
+    {
+      smoothButton.setColor(Utils::RED);
+      activeObject->smooth == true ?
+      activeObject->smooth = false : activeObject->smooth = true;
+    }
+
     if (normalsButton.hover(xMouse, HEIGHT - yMouse))
     {
       normalsButton.setColor(Utils::RED);
@@ -221,7 +408,7 @@ void processMouse(GLint button, GLint action, GLint xMouse, GLint yMouse)
 
     }
 
-    glutPostRedisplay();
+    Utils::Headless::postRedisplay();
   }
 
   if (button == GLUT_LEFT_BUTTON && action == GLUT_UP)
@@ -235,6 +422,9 @@ void processMouse(GLint button, GLint action, GLint xMouse, GLint yMouse)
     if (edgesButton.hover(xMouse, HEIGHT - yMouse))
       edgesButton.setColor(Utils::BLACK);
 
+    if (smoothButton.hover(xMouse, HEIGHT - yMouse))
+      smoothButton.setColor(Utils::BLACK);
+
     if (normalsButton.hover(xMouse, HEIGHT - yMouse))
       normalsButton.setColor(Utils::BLACK);
 
@@ -250,7 +440,8 @@ void processMouse(GLint button, GLint action, GLint xMouse, GLint yMouse)
     if (objectsButton.hover(xMouse, HEIGHT - yMouse))
       objectsButton.setColor(Utils::BLACK);
 
-    glutPostRedisplay();
+    // only a button color may have changed
+    Utils::Headless::postDamage();
   }
 
   if (button == GLUT_RIGHT_BUTTON && action == GLUT_DOWN)
@@ -269,8 +460,6 @@ void processMouse(GLint button, GLint action, GLint xMouse, GLint yMouse)
     // cache current rotation values
     lastLightX = lightSource.x();
     lastLightY = lightSource.y();
-
-    glutPostRedisplay();
   }
 }
 
@@ -297,7 +486,8 @@ void processMouseActiveMotion(GLint xMouse, GLint yMouse)
     lightSource.setY(lastLightY + v.y() * 0.25);
   }
 
-  glutPostRedisplay();
+  if (drag || lightDrag)
+    Utils::Headless::postRedisplay();
 }
 
 void keyPressed(int key, int x, int y)
@@ -318,7 +508,7 @@ void keyPressed(int key, int x, int y)
     projTrans = wtv * cp;
   }
 
-  glutPostRedisplay();
+  Utils::Headless::postRedisplay();
 }
 
 // ----------------------------------------------------------------------------
@@ -330,8 +520,12 @@ void segmentationControl(unsigned char key, int x, int y)
     activeObject->increaseSegments();
   else if (key == 's' && activeObject->getSegments() > 2)
     activeObject->decreaseSegments();
+  else if (key == 'i')
+    showInstances = !showInstances;
+  else if (key == 'o')
+    instances.occlusion = instances.occlusion ? nullptr : occlusion;
 
-  glutPostRedisplay();
+  Utils::Headless::postRedisplay();
 }
 
 // ----------------------------------------------------------------------------
@@ -339,17 +533,22 @@ void segmentationControl(unsigned char key, int x, int y)
 // ----------------------------------------------------------------------------
 int main(int argc, char **argv)
 {
-  glutInit(&argc, argv);
-  glutInitDisplayMode(GLUT_DOUBLE | GLUT_RGB);
-  glutInitWindowSize(WIDTH, HEIGHT);
-  glutCreateWindow("Homework 10");
+  Utils::Headless::createWindow(argc, argv, "Homework 10", WIDTH, HEIGHT);
+
+  if (argc > 1)
+    modelPath = argv[1];
 
   init();
-  glutDisplayFunc(display);
-  glutMouseFunc(processMouse);
-  glutMotionFunc(processMouseActiveMotion);
-  glutSpecialFunc(keyPressed);
-  glutKeyboardFunc(segmentationControl);
-  glutMainLoop();
-  return 0;
+  Utils::Headless::displayFunc(display);
+
+  // no input without a window
+  if (!Utils::Headless::active())
+  {
+    glutMouseFunc(processMouse);
+    glutMotionFunc(processMouseActiveMotion);
+    glutSpecialFunc(keyPressed);
+    glutKeyboardFunc(segmentationControl);
+  }
+
+  return Utils::Headless::mainLoop();
 }
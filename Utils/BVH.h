@@ -0,0 +1,665 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <future>
+#include <limits>
+#include <vector>
+#include "ClipVolume.h"
+#include "Mesh.h"
+
+namespace Utils
+{
+
+// ----------------------------------------------------------------------------
+// Bounding volume hierarchy over the faces of a Mesh
+//
+// Nodes are stored depth first in one array: the left child of node i is
+// node i + 1, the right child is node i.offset. Leaves reference the range
+// faceOrder[offset] .. faceOrder[offset + count - 1]. Bounds are kept in
+// float, rounded outwards, so a node is 32 bytes.
+// ----------------------------------------------------------------------------
+template <typename T>
+class BVH
+{
+public:
+  struct Box
+  {
+    float min[3];
+    float max[3];
+  };
+
+  struct Node
+  {
+    Box bounds;
+    uint32_t offset;
+    uint32_t count;
+
+    inline bool isLeaf() const
+    {
+      return count != 0;
+    }
+  };
+
+  /// Plane a * x + b * y + c * z + d = 0, inside where positive.
+  struct Plane
+  {
+    T a, b, c, d;
+  };
+
+  size_t leafSize = 4;
+  size_t maxLeafSize = 16;
+
+private:
+  typedef Point3DH<T> point_t;
+  typedef Vector3D<T> vector3D_t;
+
+  static const size_t binCount = 16;
+
+  // build time face data
+  struct BuildBox
+  {
+    T min[3];
+    T max[3];
+
+    void reset()
+    {
+      for (int k = 0; k < 3; ++k)
+      {
+        min[k] = std::numeric_limits<T>::max();
+        max[k] = -std::numeric_limits<T>::max();
+      }
+    }
+
+    void grow(const BuildBox& b)
+    {
+      for (int k = 0; k < 3; ++k)
+      {
+        min[k] = std::min(min[k], b.min[k]);
+        max[k] = std::max(max[k], b.max[k]);
+      }
+    }
+
+    void grow(const T p[3])
+    {
+      for (int k = 0; k < 3; ++k)
+      {
+        min[k] = std::min(min[k], p[k]);
+        max[k] = std::max(max[k], p[k]);
+      }
+    }
+
+    T area() const
+    {
+      T dx = max[0] - min[0], dy = max[1] - min[1], dz = max[2] - min[2];
+      return dx < 0 ? 0 : 2 * (dx * dy + dy * dz + dz * dx);
+    }
+  };
+
+  const Mesh<T> *mesh = nullptr;
+  std::vector<BuildBox> faceBoxes;
+  std::vector<T> faceCenters;
+
+  template <typename Face>
+  static BuildBox boundsOf(const Face& face)
+  {
+    BuildBox box;
+    box.reset();
+
+    for (const auto& vertex : face.vertices)
+    {
+      T p[3] = { vertex->x(), vertex->y(), vertex->z() };
+      box.grow(p);
+    }
+
+    return box;
+  }
+
+  static Box toFloat(const BuildBox& b)
+  {
+    Box box;
+
+    for (int k = 0; k < 3; ++k)
+    {
+      box.min[k] = std::nextafter(static_cast<float>(b.min[k]),
+                                  -std::numeric_limits<float>::infinity());
+      box.max[k] = std::nextafter(static_cast<float>(b.max[k]),
+                                  std::numeric_limits<float>::infinity());
+    }
+
+    return box;
+  }
+
+  // Append the subtree over faceOrder[begin, end) to out in depth first
+  // order. Child offsets are relative to out.
+  void buildRange(size_t begin, size_t end, std::vector<Node>& out,
+                  size_t parallelDepth)
+  {
+    size_t index = out.size();
+    out.emplace_back();
+
+    BuildBox bounds, centers;
+    bounds.reset();
+    centers.reset();
+
+    for (size_t i = begin; i < end; ++i)
+    {
+      bounds.grow(faceBoxes[faceOrder[i]]);
+      centers.grow(&faceCenters[3 * faceOrder[i]]);
+    }
+
+    out[index].bounds = toFloat(bounds);
+    size_t count = end - begin;
+
+    // find the cheapest binned SAH split ------------------------------------
+    int bestAxis = -1;
+    size_t bestBin = 0;
+    T bestCost = std::numeric_limits<T>::max();
+
+    if (count > leafSize)
+    {
+      for (int axis = 0; axis < 3; ++axis)
+      {
+        T extent = centers.max[axis] - centers.min[axis];
+
+        if (extent <= 0)
+          continue;
+
+        BuildBox binBoxes[binCount];
+        size_t binCounts[binCount] = { 0 };
+
+        for (auto& b : binBoxes)
+          b.reset();
+
+        T scale = binCount / extent;
+
+        for (size_t i = begin; i < end; ++i)
+        {
+          size_t face = faceOrder[i];
+          size_t bin = std::min(binCount - 1, static_cast<size_t>(
+                                  (faceCenters[3 * face + axis] -
+                                   centers.min[axis]) * scale));
+          binBoxes[bin].grow(faceBoxes[face]);
+          binCounts[bin]++;
+        }
+
+        // sweep from the right, then from the left
+        T rightArea[binCount];
+        size_t rightCount[binCount];
+        BuildBox sweep;
+        sweep.reset();
+        size_t n = 0;
+
+        for (size_t bin = binCount - 1; bin > 0; --bin)
+        {
+          sweep.grow(binBoxes[bin]);
+          n += binCounts[bin];
+          rightArea[bin] = sweep.area();
+          rightCount[bin] = n;
+        }
+
+        sweep.reset();
+        n = 0;
+
+        for (size_t bin = 0; bin < binCount - 1; ++bin)
+        {
+          sweep.grow(binBoxes[bin]);
+          n += binCounts[bin];
+
+          if (n == 0 || rightCount[bin + 1] == 0)
+            continue;
+
+          T cost = sweep.area() * n + rightArea[bin + 1] * rightCount[bin + 1];
+
+          if (cost < bestCost)
+          {
+            bestCost = cost;
+            bestAxis = axis;
+            bestBin = bin;
+          }
+        }
+      }
+    }
+
+    // costs are relative to the parent area with unit intersection cost
+    T leafCost = bounds.area() * count;
+
+    if (bestAxis < 0 || (bestCost >= leafCost && count <= maxLeafSize))
+    {
+      if (bestAxis < 0 && count > maxLeafSize)
+      {
+        // all centroids coincide, split in the middle of the range
+        size_t middle = begin + count / 2;
+        this->splitChildren(index, begin, middle, end, out, parallelDepth);
+        return;
+      }
+
+      out[index].offset = static_cast<uint32_t>(begin);
+      out[index].count = static_cast<uint32_t>(count);
+      return;
+    }
+
+    T scale = binCount / (centers.max[bestAxis] - centers.min[bestAxis]);
+    T minimum = centers.min[bestAxis];
+    const T *centerData = faceCenters.data();
+    int axis = bestAxis;
+
+    auto middle = std::partition(
+                    faceOrder.begin() + begin, faceOrder.begin() + end,
+                    [=](uint32_t face)
+    {
+      size_t bin = std::min(binCount - 1, static_cast<size_t>(
+                              (centerData[3 * face + axis] - minimum) * scale));
+      return bin <= bestBin;
+    });
+
+    this->splitChildren(index, begin, middle - faceOrder.begin(), end, out,
+                        parallelDepth);
+  }
+
+  void splitChildren(size_t index, size_t begin, size_t middle, size_t end,
+                     std::vector<Node>& out, size_t parallelDepth)
+  {
+    out[index].count = 0;
+
+    // the two halves touch disjoint ranges of faceOrder, so the left one
+    // can be built on another thread into its own node array
+    if (parallelDepth > 0 && end - begin > 4096)
+    {
+      std::vector<Node> left;
+      auto task = std::async(std::launch::async, [&]()
+      {
+        this->buildRange(begin, middle, left, parallelDepth - 1);
+      });
+
+      std::vector<Node> right;
+      this->buildRange(middle, end, right, parallelDepth - 1);
+      task.get();
+
+      size_t leftBase = out.size();
+      size_t rightBase = leftBase + left.size();
+
+      for (auto node : left)
+      {
+        if (!node.isLeaf())
+          node.offset += static_cast<uint32_t>(leftBase);
+
+        out.push_back(node);
+      }
+
+      for (auto node : right)
+      {
+        if (!node.isLeaf())
+          node.offset += static_cast<uint32_t>(rightBase);
+
+        out.push_back(node);
+      }
+
+      out[index].offset = static_cast<uint32_t>(rightBase);
+    }
+    else
+    {
+      this->buildRange(begin, middle, out, 0);
+      out[index].offset = static_cast<uint32_t>(out.size());
+      this->buildRange(middle, end, out, 0);
+    }
+  }
+
+  static bool overlaps(const Box& a, const Box& b)
+  {
+    for (int k = 0; k < 3; ++k)
+      if (a.max[k] < b.min[k] || a.min[k] > b.max[k])
+        return false;
+
+    return true;
+  }
+
+  static bool rayHitsBox(const Box& box, const T origin[3],
+                         const T invDir[3], T maxDistance)
+  {
+    T tmin = 0, tmax = maxDistance;
+
+    for (int k = 0; k < 3; ++k)
+    {
+      T t1 = (box.min[k] - origin[k]) * invDir[k];
+      T t2 = (box.max[k] - origin[k]) * invDir[k];
+
+      if (t1 > t2)
+        std::swap(t1, t2);
+
+      tmin = std::max(tmin, t1);
+      tmax = std::min(tmax, t2);
+
+      if (tmin > tmax)
+        return false;
+    }
+
+    return true;
+  }
+
+  // Moller-Trumbore, returns distance along the ray or a negative value
+  static T rayHitsTriangle(const point_t& a, const point_t& b,
+                           const point_t& c, const point_t& origin,
+                           const vector3D_t& dir)
+  {
+    vector3D_t e1(a, b);
+    vector3D_t e2(a, c);
+    auto p = vector3D_t::crossProduct(dir, e2);
+    T det = vector3D_t::dotProduct(e1, p);
+
+    if (std::abs(det) < std::numeric_limits<T>::epsilon())
+      return -1;
+
+    T inv = 1 / det;
+    vector3D_t s(a, origin);
+    T u = vector3D_t::dotProduct(s, p) * inv;
+
+    if (u < 0 || u > 1)
+      return -1;
+
+    auto q = vector3D_t::crossProduct(s, e1);
+    T v = vector3D_t::dotProduct(dir, q) * inv;
+
+    if (v < 0 || u + v > 1)
+      return -1;
+
+    return vector3D_t::dotProduct(e2, q) * inv;
+  }
+
+public:
+  std::vector<Node> nodes;
+  std::vector<uint32_t> faceOrder;
+
+  BVH() {}
+
+  BVH(const Mesh<T>& mesh, bool parallel = true)
+  {
+    this->build(mesh, parallel);
+  }
+
+  /// Build the hierarchy. With parallel set the top levels of large meshes
+  /// are built on separate threads.
+  void build(const Mesh<T>& mesh, bool parallel = true)
+  {
+    this->mesh = &mesh;
+    size_t faceCount = mesh.faces.size();
+
+    nodes.clear();
+    faceOrder.resize(faceCount);
+    faceBoxes.resize(faceCount);
+    faceCenters.resize(3 * faceCount);
+
+    for (size_t i = 0; i < faceCount; ++i)
+    {
+      faceOrder[i] = static_cast<uint32_t>(i);
+      faceBoxes[i] = boundsOf(mesh.faces[i]);
+
+      for (int k = 0; k < 3; ++k)
+        faceCenters[3 * i + k] =
+          (faceBoxes[i].min[k] + faceBoxes[i].max[k]) / 2;
+    }
+
+    if (faceCount)
+    {
+      nodes.reserve(2 * faceCount / std::max<size_t>(leafSize, 1) + 1);
+      this->buildRange(0, faceCount, nodes, parallel ? 3 : 0);
+    }
+
+    faceBoxes.clear();
+    faceBoxes.shrink_to_fit();
+    faceCenters.clear();
+    faceCenters.shrink_to_fit();
+  }
+
+  /// Recompute bounds after vertices moved, keeping the tree topology.
+  /// Cheap, but the tree degrades if faces move far from each other.
+  void refit()
+  {
+    if (!mesh)
+      return;
+
+    // children are always stored after their parent
+    for (size_t i = nodes.size(); i-- > 0;)
+    {
+      auto& node = nodes[i];
+      BuildBox box;
+      box.reset();
+
+      if (node.isLeaf())
+      {
+        for (size_t j = node.offset; j < node.offset + node.count; ++j)
+          box.grow(boundsOf(mesh->faces[faceOrder[j]]));
+
+        node.bounds = toFloat(box);
+      }
+      else
+      {
+        const Box& left = nodes[i + 1].bounds;
+        const Box& right = nodes[node.offset].bounds;
+
+        for (int k = 0; k < 3; ++k)
+        {
+          node.bounds.min[k] = std::min(left.min[k], right.min[k]);
+          node.bounds.max[k] = std::max(left.max[k], right.max[k]);
+        }
+      }
+    }
+  }
+
+  /// Closest face hit by a ray. Returns false if nothing is hit.
+  bool intersectRay(const point_t& origin, const vector3D_t& direction,
+                    size_t& face, T& distance) const
+  {
+    if (nodes.empty())
+      return false;
+
+    T o[3] = { origin.x(), origin.y(), origin.z() };
+    T d[3] = { direction.x(), direction.y(), direction.z() };
+    T invDir[3];
+
+    for (int k = 0; k < 3; ++k)
+      invDir[k] = d[k] != 0 ? 1 / d[k] : std::numeric_limits<T>::max();
+
+    distance = std::numeric_limits<T>::max();
+    bool hit = false;
+
+    std::vector<uint32_t> stack(1, 0);
+
+    while (!stack.empty())
+    {
+      uint32_t index = stack.back();
+      stack.pop_back();
+      const Node& node = nodes[index];
+
+      if (!rayHitsBox(node.bounds, o, invDir, distance))
+        continue;
+
+      if (node.isLeaf())
+      {
+        for (size_t j = node.offset; j < node.offset + node.count; ++j)
+        {
+          const auto& vertices = mesh->faces[faceOrder[j]].vertices;
+
+          // fan triangulation of the face polygon
+          for (size_t k = 1; k + 1 < vertices.size(); ++k)
+          {
+            T t = rayHitsTriangle(*vertices[0], *vertices[k], *vertices[k + 1],
+                                  origin, direction);
+
+            if (t >= 0 && t < distance)
+            {
+              distance = t;
+              face = faceOrder[j];
+              hit = true;
+            }
+          }
+        }
+      }
+      else
+      {
+        stack.push_back(node.offset);
+        stack.push_back(index + 1);
+      }
+    }
+
+    return hit;
+  }
+
+  /// Faces whose bounds overlap an axis aligned box.
+  void queryBox(const point_t& min, const point_t& max,
+                std::vector<size_t>& result) const
+  {
+    result.clear();
+
+    if (nodes.empty())
+      return;
+
+    BuildBox query;
+    query.reset();
+    T corners[2][3] =
+    {
+      { min.x(), min.y(), min.z() },
+      { max.x(), max.y(), max.z() }
+    };
+    query.grow(corners[0]);
+    query.grow(corners[1]);
+    Box box = toFloat(query);
+
+    std::vector<uint32_t> stack(1, 0);
+
+    while (!stack.empty())
+    {
+      uint32_t index = stack.back();
+      stack.pop_back();
+      const Node& node = nodes[index];
+
+      if (!overlaps(node.bounds, box))
+        continue;
+
+      if (node.isLeaf())
+      {
+        for (size_t j = node.offset; j < node.offset + node.count; ++j)
+          result.push_back(faceOrder[j]);
+      }
+      else
+      {
+        stack.push_back(node.offset);
+        stack.push_back(index + 1);
+      }
+    }
+  }
+
+  /// Faces whose bounds are not completely outside any of the planes.
+  /// Subtrees fully inside every plane are accepted without further tests.
+  void queryFrustum(const std::vector<Plane>& planes,
+                    std::vector<size_t>& result) const
+  {
+    result.clear();
+
+    if (nodes.empty())
+      return;
+
+    std::vector<std::pair<uint32_t, bool>> stack(1, std::make_pair(0u, false));
+
+    while (!stack.empty())
+    {
+      uint32_t index = stack.back().first;
+      bool inside = stack.back().second;
+      stack.pop_back();
+      const Node& node = nodes[index];
+
+      if (!inside)
+      {
+        bool outside = false;
+        inside = true;
+
+        for (const auto& plane : planes)
+        {
+          // box corners furthest along and against the plane normal
+          T pos[3], neg[3];
+          T n[3] = { plane.a, plane.b, plane.c };
+
+          for (int k = 0; k < 3; ++k)
+          {
+            pos[k] = n[k] >= 0 ? node.bounds.max[k] : node.bounds.min[k];
+            neg[k] = n[k] >= 0 ? node.bounds.min[k] : node.bounds.max[k];
+          }
+
+          if (n[0] * pos[0] + n[1] * pos[1] + n[2] * pos[2] + plane.d < 0)
+          {
+            outside = true;
+            break;
+          }
+
+          if (n[0] * neg[0] + n[1] * neg[1] + n[2] * neg[2] + plane.d < 0)
+            inside = false;
+        }
+
+        if (outside)
+          continue;
+      }
+
+      if (node.isLeaf())
+      {
+        for (size_t j = node.offset; j < node.offset + node.count; ++j)
+          result.push_back(faceOrder[j]);
+      }
+      else
+      {
+        stack.emplace_back(node.offset, inside);
+        stack.emplace_back(index + 1, inside);
+      }
+    }
+  }
+
+  /// Planes of a clip volume in the space of the points m is applied to,
+  /// for queryFrustum. m is the matrix the drawing code transforms vertices
+  /// with before clipping, e.g. wtv * cp * rot: it leaves x / w and y / w in
+  /// viewport coordinates and w as the depth weight of CentralProjection,
+  /// as ClipVolume expects. Only the planes enabled in clip are returned.
+  static std::vector<Plane> frustumPlanes(const Matrix<T>& m,
+                                          const ClipVolume<T>& clip)
+  {
+    typedef typename ClipVolume<T>::Plane ClipPlane;
+    std::vector<Plane> planes;
+    const Point3DH<T> origin(0, 0, 0, 0);
+
+    for (int i = 0; i < ClipVolume<T>::PLANE_COUNT; ++i)
+    {
+      ClipPlane plane = ClipPlane(i);
+
+      if (!clip.isEnabled(plane))
+        continue;
+
+      // the distance is affine in the clip coordinates, its coefficients
+      // are read off at the origin and the unit vectors
+      T offset = clip.distance(plane, origin);
+      T c[4];
+
+      for (int j = 0; j < 4; ++j)
+      {
+        Point3DH<T> unit(T(j == 0), T(j == 1), T(j == 2), T(j == 3));
+        c[j] = clip.distance(plane, unit) - offset;
+      }
+
+      T coefficients[4];
+
+      for (int k = 0; k < 4; ++k)
+        coefficients[k] = c[0] * m(0, k) + c[1] * m(1, k) +
+                          c[2] * m(2, k) + c[3] * m(3, k);
+
+      // points of the mesh have w = 1
+      planes.push_back(Plane
+      {
+        coefficients[0], coefficients[1], coefficients[2],
+        coefficients[3] + offset
+      });
+    }
+
+    return planes;
+  }
+
+}; // end class BVH
+
+} // end namespace Utils
@@ -1,10 +1,14 @@
 #pragma once
 
 #include <GL/freeglut.h>
+#include <algorithm>
+#include <cmath>
 #include "functions.h"
+#include "ForwardDifferences.h"
 #include "Point2D.h"
 #include "Line.h"
 #include "Color.h"
+#include "Matrix.h"
 
 namespace Utils
 {
@@ -18,6 +22,162 @@ class Bezier2D
 protected:
   size_t points = 0;
 
+  // parameter step of fixed sampling, when pixelTolerance is 0
+  static const size_t SAMPLES = 100;
+  static constexpr double STEP = 1.0 / SAMPLES;
+
+  // deepest subdivision of adaptive flattening, at most 2^16 segments
+  static const size_t MAX_DEPTH = 16;
+
+  mutable ForwardDifferences sampler;
+
+  // line strip of the last flatten(), x and y interleaved
+  mutable std::vector<double> strip;
+
+  // pieces still to flatten, each its control points followed by its depth
+  mutable std::vector<double> pieces;
+
+  /// True if the inner control points of a piece lie within pixelTolerance
+  /// of its chord, after the linear part a, b, c, d of the screen transform.
+  /// The curve stays inside their hull, so it is as close to the chord.
+  bool isFlat(const double *x, const double *y, size_t n,
+              double a, double b, double c, double d) const
+  {
+    const double x0 = a * x[0] + b * y[0];
+    const double y0 = c * x[0] + d * y[0];
+    const double cx = a * x[n - 1] + b * y[n - 1] - x0;
+    const double cy = c * x[n - 1] + d * y[n - 1] - y0;
+    const double chord = std::sqrt(cx * cx + cy * cy);
+
+    for (size_t i = 1; i + 1 < n; i++)
+    {
+      const double px = a * x[i] + b * y[i] - x0;
+      const double py = c * x[i] + d * y[i] - y0;
+
+      // a closed piece is measured from its end points
+      double distance = chord > 1e-12 ? std::fabs(cx * py - cy * px) / chord
+                        : std::sqrt(px * px + py * py);
+
+      if (distance > pixelTolerance)
+        return false;
+    }
+
+    return true;
+  }
+
+  /// Flatten the curve on [0, param] into strip.
+  void flattenScaled(double param, double a, double b, double c,
+                     double d) const
+  {
+    strip.clear();
+
+    const size_t n = this->controlPoints.size();
+
+    if (!n)
+      return;
+
+    param = std::min(std::max(param, 0.0), 1.0);
+
+    if (pixelTolerance <= 0)
+    {
+      sampler.start(this->controlPoints, STEP, accuracyGuard);
+
+      while (sampler.t() < param - 1e-9)
+      {
+        strip.push_back(sampler.x());
+        strip.push_back(sampler.y());
+        sampler.next();
+      }
+
+      double x, y;
+      sampler.exact(param, x, y);
+      strip.push_back(x);
+      strip.push_back(y);
+      return;
+    }
+
+    // the piece on [0, param] is the first diagonal of de Casteljau
+    const size_t size = 2 * n + 1;
+    pieces.resize(size);
+    double *x = &pieces[0];
+    double *y = x + n;
+
+    for (size_t i = 0; i < n; i++)
+    {
+      x[i] = static_cast<double>(this->controlPoints[i].x());
+      y[i] = static_cast<double>(this->controlPoints[i].y());
+    }
+
+    for (size_t r = 1; r < n; r++)
+    {
+      for (size_t i = n - 1; i >= r; i--)
+      {
+        x[i] = (1 - param) * x[i - 1] + param * x[i];
+        y[i] = (1 - param) * y[i - 1] + param * y[i];
+      }
+    }
+
+    pieces[2 * n] = 0;
+    strip.push_back(x[0]);
+    strip.push_back(y[0]);
+
+    // depth first, the left half is on top of the stack
+    while (!pieces.empty())
+    {
+      const size_t top = pieces.size() - size;
+      x = &pieces[top];
+      y = x + n;
+      const double depth = pieces[top + 2 * n];
+
+      if (depth >= MAX_DEPTH || this->isFlat(x, y, n, a, b, c, d))
+      {
+        strip.push_back(x[n - 1]);
+        strip.push_back(y[n - 1]);
+        pieces.resize(top);
+        continue;
+      }
+
+      // split at 0.5: the right half stays in place, the left half goes
+      // above it
+      pieces.resize(top + 2 * size);
+      x = &pieces[top];
+      y = x + n;
+      double *lx = &pieces[top + size];
+      double *ly = lx + n;
+
+      for (size_t r = 0; r < n; r++)
+      {
+        lx[r] = x[0];
+        ly[r] = y[0];
+
+        for (size_t i = 0; i + r + 1 < n; i++)
+        {
+          x[i] = 0.5 * (x[i] + x[i + 1]);
+          y[i] = 0.5 * (y[i] + y[i + 1]);
+        }
+      }
+
+      pieces[top + 2 * n] = depth + 1;
+      pieces[top + size + 2 * n] = depth + 1;
+    }
+  }
+
+  void drawStrip(const std::vector<double>& vertices) const
+  {
+    if (vertices.empty())
+      return;
+
+    renderLineWidth(lineWidth);
+    this->curveColor.setGLColor();
+
+    renderBegin(GL_LINE_STRIP);
+
+    for (size_t i = 0; i < vertices.size(); i += 2)
+      glVertex2<T>(vertices[i], vertices[i + 1]);
+
+    renderEnd();
+  }
+
 public:
   std::vector<Point2D<T>> controlPoints;
   std::vector<Color> colorCycle;
@@ -29,6 +189,14 @@ public:
   Color controlPolygonColor = VERY_LIGHT_GRAY;
   bool clicked = false;
 
+  // largest distance in pixels between the curve and the line strip drawn
+  // for it, 0 samples the curve at fixed steps instead
+  double pixelTolerance = 0.25;
+
+  // samples between checks of forward differencing against de Casteljau,
+  // 0 turns the check off
+  size_t accuracyGuard = 25;
+
   Bezier2D()
   {
     this->colorCycle.emplace_back(GREEN);
@@ -126,23 +294,25 @@ public:
     if (!this->points)
       return;
 
-    glLineWidth(lineWidth);
+    renderLineWidth(lineWidth);
     curveColor.setGLColor();
 
-    glBegin(GL_LINE_STRIP);
+    renderBegin(GL_LINE_STRIP);
 
     size_t n = this->points;
+    std::vector<double> basis;
 
     for (double t = 0.0f; t < 1.0; t += 0.01)
     {
       double sumX = 0.0f;
       double sumY = 0.0f;
 
+      bernsteinBasis(n - 1, t, basis);
+
       for (size_t i = 0; i < n; i++)
       {
-        double bp = bernsteinPolynomial(n - 1, i, t);
-        sumX += bp * this->controlPoints[i].x();
-        sumY += bp * this->controlPoints[i].y();
+        sumX += basis[i] * this->controlPoints[i].x();
+        sumY += basis[i] * this->controlPoints[i].y();
       }
 
       glVertex2<T>(sumX, sumY);
@@ -150,7 +320,7 @@ public:
 
     glVertex2<T>(this->controlPoints.back());
 
-    glEnd();
+    renderEnd();
   }
 
   Point2D<T> calcPointOnCurve(double t) const
@@ -165,44 +335,41 @@ public:
     return temp[0];
   }
 
-  void draw() const
+  /// Line strip through the curve on [0, param] with x and y interleaved.
+  /// Segments are subdivided until they are within pixelTolerance of the
+  /// curve once the window to viewport transform wtv maps it to pixels.
+  const std::vector<double>& flatten(const Matrix<T>& wtv,
+                                     double param = 1.0) const
   {
-    if (!this->points)
-      return;
-
-    glLineWidth(lineWidth);
-    this->curveColor.setGLColor();
-
-    glBegin(GL_LINE_STRIP);
+    this->flattenScaled(param, wtv(0, 0), wtv(0, 1), wtv(1, 0), wtv(1, 1));
+    return strip;
+  }
 
-    for (double t = 0.0f; t < 1.0; t += 0.01)
-    {
-      glVertex2<T>(calcPointOnCurve(t));
-    }
+  /// Line strip through the curve on [0, param], drawn in pixels.
+  const std::vector<double>& flatten(double param = 1.0) const
+  {
+    this->flattenScaled(param, 1.0, 0.0, 0.0, 1.0);
+    return strip;
+  }
 
-    glVertex2<T>(this->controlPoints.back());
+  void draw() const
+  {
+    this->drawStrip(this->flatten());
+  }
 
-    glEnd();
+  void draw(const Matrix<T>& wtv) const
+  {
+    this->drawStrip(this->flatten(wtv));
   }
 
   void drawUntilParam(double param) const
   {
-    if (!this->points)
-      return;
-
-    glLineWidth(lineWidth);
-    this->curveColor.setGLColor();
-
-    glBegin(GL_LINE_STRIP);
-
-    for (double t = 0.0f; t <= param; t += 0.01)
-    {
-      glVertex2<T>(calcPointOnCurve(t));
-    }
-
-    glVertex2<T>(calcPointOnCurve(param));
+    this->drawStrip(this->flatten(param));
+  }
 
-    glEnd();
+  void drawUntilParam(double param, const Matrix<T>& wtv) const
+  {
+    this->drawStrip(this->flatten(wtv, param));
   }
 
   void drawPoints() const
@@ -210,9 +377,9 @@ public:
     if (!this->points)
       return;
 
-    glPointSize(pointSize);
+    renderPointSize(pointSize);
 
-    glBegin(GL_POINTS);
+    renderBegin(GL_POINTS);
 
     for (const auto& point : this->controlPoints)
     {
@@ -220,7 +387,7 @@ public:
       glVertex2<T>(point);
     }
 
-    glEnd();
+    renderEnd();
   }
 
   void drawControlPolygon() const
@@ -229,14 +396,14 @@ public:
       return;
 
     this->controlPolygonColor.setGLColor();
-    glBegin(GL_LINE_STRIP);
+    renderBegin(GL_LINE_STRIP);
 
     for (const auto& point : this->controlPoints)
     {
       glVertex2<T>(point);
     }
 
-    glEnd();
+    renderEnd();
   }
 
   void drawInterPolations(double t, bool points = true) const
@@ -244,7 +411,7 @@ public:
     if (!this->points)
       return;
 
-    glLineWidth(interpolationLinesWidth);
+    renderLineWidth(interpolationLinesWidth);
 
     auto n = this->controlPoints.size();
     auto temp = this->controlPoints;
@@ -263,35 +430,35 @@ public:
 
       colorIterator->setGLColor();
 
-      glBegin(GL_LINE_STRIP);
+      renderBegin(GL_LINE_STRIP);
 
       for (size_t j = 0; j < n - r; j++)
       {
         glVertex2<T>(temp[j]);
       }
 
-      glEnd();
+      renderEnd();
 
       if (points)
       {
-        glPointSize(pointSize - 2);
-        glBegin(GL_POINTS);
+        renderPointSize(pointSize - 2);
+        renderBegin(GL_POINTS);
 
         for (size_t j = 0; j < n - r; j++)
         {
           glVertex2<T>(temp[j]);
         }
 
-        glEnd();
+        renderEnd();
       }
 
       colorIterator++;
     }
 
     this->curveColor.setGLColor();
-    glBegin(GL_POINTS);
+    renderBegin(GL_POINTS);
     glVertex2<T>(temp[0]);
-    glEnd();
+    renderEnd();
   }
 
 }; // end class Bezier2D
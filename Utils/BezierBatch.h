@@ -0,0 +1,308 @@
+#pragma once
+
+#include <GL/freeglut.h>
+#include <algorithm>
+#include <vector>
+
+// SSE2 is always there on x86-64, MSVC does not define __SSE2__ though
+#if defined(__SSE2__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define UTILS_BEZIER_SSE2
+#include <emmintrin.h>
+#endif
+
+#include "functions.h"
+#include "Color.h"
+#include "Render.h"
+
+namespace Utils
+{
+
+// ----------------------------------------------------------------------------
+// Many Bezier curves of the same degree, evaluated together at shared
+// parameter values. Control points are stored as structure of arrays, one
+// array of x and one of y per control point index, and the Bernstein
+// weights of the shared parameters are computed once. A curve is then a
+// weighted sum of weight arrays, evaluated four samples at a time with SSE2
+// where available, writing the samples of each curve in order straight into
+// the position arena of a CommandBuffer.
+// ----------------------------------------------------------------------------
+class BezierBatch
+{
+private:
+  size_t degree;
+  size_t curves = 0;
+
+  // xs[k][c] is control point k of curve c
+  std::vector<std::vector<GLfloat>> xs;
+  std::vector<std::vector<GLfloat>> ys;
+
+  // weights[k][s] is the Bernstein weight of control point k at sample s
+  size_t samples = 0;
+  std::vector<std::vector<GLfloat>> weights;
+
+  // used by draw() when nothing is recording
+  mutable CommandBuffer frame;
+  mutable GLVertexArrayBackend backend;
+
+  /// Sample s of curve c, scalar.
+  inline void evaluateSample(size_t c, size_t s, GLfloat *out) const
+  {
+    GLfloat x = 0, y = 0;
+
+    for (size_t k = 0; k <= degree; k++)
+    {
+      x += weights[k][s] * xs[k][c];
+      y += weights[k][s] * ys[k][c];
+    }
+
+    out[2 * s] = x;
+    out[2 * s + 1] = y;
+  }
+
+  /// Samples of curve c to out, x and y interleaved.
+  void evaluateCurve(size_t c, GLfloat *out) const
+  {
+#ifdef UTILS_BEZIER_SSE2
+    size_t s = 0;
+
+    // four samples at a time, x and y summed in separate registers and
+    // interleaved on the way out
+    const size_t blocks = samples / 4 * 4;
+
+    if (degree == 3)
+    {
+      // cubic curves with the control points held in registers
+      const __m128 x0 = _mm_set1_ps(xs[0][c]), y0 = _mm_set1_ps(ys[0][c]);
+      const __m128 x1 = _mm_set1_ps(xs[1][c]), y1 = _mm_set1_ps(ys[1][c]);
+      const __m128 x2 = _mm_set1_ps(xs[2][c]), y2 = _mm_set1_ps(ys[2][c]);
+      const __m128 x3 = _mm_set1_ps(xs[3][c]), y3 = _mm_set1_ps(ys[3][c]);
+
+      for (; s < blocks; s += 4)
+      {
+        const __m128 w0 = _mm_loadu_ps(&weights[0][s]);
+        const __m128 w1 = _mm_loadu_ps(&weights[1][s]);
+        const __m128 w2 = _mm_loadu_ps(&weights[2][s]);
+        const __m128 w3 = _mm_loadu_ps(&weights[3][s]);
+
+        __m128 x = _mm_add_ps(_mm_add_ps(_mm_mul_ps(w0, x0),
+                                         _mm_mul_ps(w1, x1)),
+                              _mm_add_ps(_mm_mul_ps(w2, x2),
+                                         _mm_mul_ps(w3, x3)));
+        __m128 y = _mm_add_ps(_mm_add_ps(_mm_mul_ps(w0, y0),
+                                         _mm_mul_ps(w1, y1)),
+                              _mm_add_ps(_mm_mul_ps(w2, y2),
+                                         _mm_mul_ps(w3, y3)));
+
+        _mm_storeu_ps(out + 2 * s, _mm_unpacklo_ps(x, y));
+        _mm_storeu_ps(out + 2 * s + 4, _mm_unpackhi_ps(x, y));
+      }
+    }
+    else
+    {
+      for (; s < blocks; s += 4)
+      {
+        __m128 x = _mm_setzero_ps();
+        __m128 y = _mm_setzero_ps();
+
+        for (size_t k = 0; k <= degree; k++)
+        {
+          const __m128 w = _mm_loadu_ps(&weights[k][s]);
+          x = _mm_add_ps(x, _mm_mul_ps(w, _mm_set1_ps(xs[k][c])));
+          y = _mm_add_ps(y, _mm_mul_ps(w, _mm_set1_ps(ys[k][c])));
+        }
+
+        _mm_storeu_ps(out + 2 * s, _mm_unpacklo_ps(x, y));
+        _mm_storeu_ps(out + 2 * s + 4, _mm_unpackhi_ps(x, y));
+      }
+    }
+
+    // remaining samples
+    for (; s < samples; s++)
+      this->evaluateSample(c, s, out);
+#else
+    if (degree == 3)
+    {
+      // cubic curves in a single pass
+      const GLfloat x0 = xs[0][c], x1 = xs[1][c], x2 = xs[2][c];
+      const GLfloat x3 = xs[3][c];
+      const GLfloat y0 = ys[0][c], y1 = ys[1][c], y2 = ys[2][c];
+      const GLfloat y3 = ys[3][c];
+      const GLfloat *w0 = weights[0].data();
+      const GLfloat *w1 = weights[1].data();
+      const GLfloat *w2 = weights[2].data();
+      const GLfloat *w3 = weights[3].data();
+
+      for (size_t s = 0; s < samples; s++)
+      {
+        out[2 * s] = w0[s] * x0 + w1[s] * x1 + w2[s] * x2 + w3[s] * x3;
+        out[2 * s + 1] = w0[s] * y0 + w1[s] * y1 + w2[s] * y2 + w3[s] * y3;
+      }
+
+      return;
+    }
+
+    const GLfloat *w = weights[0].data();
+    GLfloat x = xs[0][c];
+    GLfloat y = ys[0][c];
+
+    for (size_t s = 0; s < samples; s++)
+    {
+      out[2 * s] = w[s] * x;
+      out[2 * s + 1] = w[s] * y;
+    }
+
+    for (size_t k = 1; k <= degree; k++)
+    {
+      w = weights[k].data();
+      x = xs[k][c];
+      y = ys[k][c];
+
+      for (size_t s = 0; s < samples; s++)
+      {
+        out[2 * s] += w[s] * x;
+        out[2 * s + 1] += w[s] * y;
+      }
+    }
+#endif
+  }
+
+public:
+  Color color = BLACK;
+  GLfloat lineWidth = 1.0;
+
+  explicit BezierBatch(size_t degree = 3, size_t samples = 101)
+    : degree(degree), xs(degree + 1), ys(degree + 1), weights(degree + 1)
+  {
+    this->setSamples(samples);
+  }
+
+  virtual ~BezierBatch()
+  {}
+
+  inline size_t getDegree() const
+  {
+    return degree;
+  }
+
+  /// Number of curves.
+  inline size_t size() const
+  {
+    return curves;
+  }
+
+  inline size_t getSamples() const
+  {
+    return samples;
+  }
+
+  void clear()
+  {
+    for (size_t k = 0; k <= degree; k++)
+    {
+      xs[k].clear();
+      ys[k].clear();
+    }
+
+    curves = 0;
+  }
+
+  /// Add a curve, false if its number of control points does not match the
+  /// degree of the batch.
+  template <typename P>
+  bool add(const std::vector<P>& controlPoints)
+  {
+    if (controlPoints.size() != degree + 1)
+      return false;
+
+    for (size_t k = 0; k <= degree; k++)
+    {
+      xs[k].push_back(static_cast<GLfloat>(controlPoints[k].x()));
+      ys[k].push_back(static_cast<GLfloat>(controlPoints[k].y()));
+    }
+
+    ++curves;
+    return true;
+  }
+
+  /// Move control point k of a curve.
+  inline void setPoint(size_t curve, size_t k, GLfloat x, GLfloat y)
+  {
+    xs[k][curve] = x;
+    ys[k][curve] = y;
+  }
+
+  /// Sample every curve at count equally spaced parameters, both ends
+  /// included.
+  void setSamples(size_t count)
+  {
+    std::vector<double> t(std::max<size_t>(count, 2));
+
+    for (size_t s = 0; s < t.size(); s++)
+      t[s] = static_cast<double>(s) / (t.size() - 1);
+
+    this->setParameters(t);
+  }
+
+  /// Sample every curve at the given parameters.
+  void setParameters(const std::vector<double>& t)
+  {
+    samples = t.size();
+    std::vector<double> basis;
+
+    for (size_t k = 0; k <= degree; k++)
+      weights[k].resize(samples);
+
+    for (size_t s = 0; s < samples; s++)
+    {
+      bernsteinBasis(degree, t[s], basis);
+
+      for (size_t k = 0; k <= degree; k++)
+        weights[k][s] = static_cast<GLfloat>(basis[k]);
+    }
+  }
+
+  /// Write the samples of all curves to out, x and y interleaved, the
+  /// samples of each curve one after the other. out holds
+  /// 2 * size() * getSamples() floats.
+  void evaluate(GLfloat *out) const
+  {
+    for (size_t c = 0; c < curves; c++)
+      this->evaluateCurve(c, out + 2 * c * samples);
+  }
+
+  /// Append one line strip per curve to a buffer.
+  void record(CommandBuffer& buffer) const
+  {
+    if (!curves || !samples)
+      return;
+
+    buffer.setColor(color.red(), color.green(), color.blue(), color.alpha());
+    buffer.setLineWidth(lineWidth);
+
+    const size_t first = buffer.vertexCount();
+
+    for (size_t c = 0; c < curves; c++)
+    {
+      buffer.begin(GL_LINE_STRIP);
+      buffer.addVertices(samples);
+      buffer.end();
+    }
+
+    this->evaluate(&buffer.positions[2 * first]);
+  }
+
+  /// Draw all curves, into the recording buffer if there is one.
+  void draw() const
+  {
+    if (auto buffer = recordingBuffer())
+      return this->record(*buffer);
+
+    frame.clear();
+    this->record(frame);
+    frame.replay(backend);
+  }
+
+}; // end class BezierBatch
+
+} // end namespace Utils
@@ -1,8 +1,10 @@
 #pragma once
 
 #include <GL/freeglut.h>
+#include <cmath>
 #include <string>
 #include "Rectangle.h"
+#include "Damage.h"
 
 namespace Utils
 {
@@ -30,15 +32,29 @@ public:
 
   inline void setLabel(const std::string& value)
   {
+    if (label != value)
+      damage();
+
     label = value;
   }
 
   inline void setColor(Color color)
   {
+    if (this->color != color)
+      damage();
+
     this->color = color;
     this->body.color = color;
   }
 
+  /// Damage the window under the button and its outline.
+  inline void damage() const
+  {
+    GLint r = static_cast<GLint>(std::ceil(body.lineWidth / 2)) + 1;
+    Damage::add(body.left() - r, body.bottom() - r, body.right() + r + 1,
+                body.top() + r + 1);
+  }
+
   inline size_t getPaddingY() const
   {
     return paddingY;
@@ -69,8 +85,8 @@ public:
     body.draw();
     color.setGLColor();
 
-    glRasterPos2i(body.left() + paddingX, body.bottom() + paddingY);
-    glutBitmapString(GLUT_BITMAP_HELVETICA_18, (unsigned char *)label.c_str());
+    renderText(body.left() + paddingX, body.bottom() + paddingY,
+               GLUT_BITMAP_HELVETICA_18, label);
   }
 };
 
@@ -0,0 +1,256 @@
+#pragma once
+
+#include <algorithm>
+#include <limits>
+#include <vector>
+#include "Point3D.h"
+#include "Rectangle.h"
+
+namespace Utils
+{
+
+// ----------------------------------------------------------------------------
+// Vertex access used by ClipVolume::clipPolygon. Vertex types carrying extra
+// attributes provide their own overloads, found by argument dependent lookup.
+// ----------------------------------------------------------------------------
+template <typename T>
+inline const Point3DH<T>& clipPosition(const Point3DH<T>& p)
+{
+  return p;
+}
+
+template <typename T>
+inline Point3DH<T> clipLerp(const Point3DH<T>& a, const Point3DH<T>& b, T t)
+{
+  return Point3DH<T>(a.x() + (b.x() - a.x()) * t,
+                     a.y() + (b.y() - a.y()) * t,
+                     a.z() + (b.z() - a.z()) * t,
+                     a.w() + (b.w() - a.w()) * t);
+}
+
+// ----------------------------------------------------------------------------
+// Clip volume in homogeneous coordinates, applied after the projection
+// matrix and before the perspective divide.
+//
+// Side planes are given in divided (projected) coordinates, e.g. the
+// viewport of a WindowToViewport transform, and tested as left * w <= x etc.
+// The near plane keeps w >= nearW, so nothing at or behind the eye reaches
+// the divide. Only the near plane is enabled by default.
+// ----------------------------------------------------------------------------
+template <typename T>
+class ClipVolume
+{
+public:
+  enum Plane
+  {
+    LEFT, RIGHT, BOTTOM, TOP, NEAR_PLANE, FAR_PLANE, PLANE_COUNT
+  };
+
+private:
+  T left = 0, right = 0, bottom = 0, top = 0;
+  T nearW = 1e-5f;
+  T farW = 0;
+  unsigned enabled = 1u << NEAR_PLANE;
+
+public:
+  ClipVolume() {}
+
+  /// Clip x and y to a rectangle in projected coordinates.
+  void setBounds(T left, T bottom, T right, T top)
+  {
+    this->left = left;
+    this->bottom = bottom;
+    this->right = right;
+    this->top = top;
+    enabled |= (1u << LEFT) | (1u << RIGHT) | (1u << BOTTOM) | (1u << TOP);
+  }
+
+  /// Clip x and y to a rectangle in projected coordinates. (overload)
+  void setBounds(const Rectangle<T>& rect)
+  {
+    this->setBounds(rect.left(), rect.bottom(), rect.right(), rect.top());
+  }
+
+  /// Stop clipping x and y.
+  void clearBounds()
+  {
+    enabled &= ~((1u << LEFT) | (1u << RIGHT) | (1u << BOTTOM) | (1u << TOP));
+  }
+
+  /// Smallest w allowed through, must be positive.
+  inline void setNear(T minW)
+  {
+    nearW = minW;
+  }
+
+  /// Largest w allowed through. Zero disables the far plane.
+  inline void setFar(T maxW)
+  {
+    farW = maxW;
+
+    if (maxW > 0)
+      enabled |= 1u << FAR_PLANE;
+    else
+      enabled &= ~(1u << FAR_PLANE);
+  }
+
+  /// True if points are clipped against the plane.
+  inline bool isEnabled(Plane plane) const
+  {
+    return (enabled & (1u << plane)) != 0;
+  }
+
+  /// Signed distance-like value of a point to a plane, inside if >= 0.
+  inline T distance(Plane plane, const Point3DH<T>& p) const
+  {
+    switch (plane)
+    {
+    case LEFT:
+      return p.x() - left * p.w();
+
+    case RIGHT:
+      return right * p.w() - p.x();
+
+    case BOTTOM:
+      return p.y() - bottom * p.w();
+
+    case TOP:
+      return top * p.w() - p.y();
+
+    case NEAR_PLANE:
+      return p.w() - nearW;
+
+    case FAR_PLANE:
+      return farW - p.w();
+
+    default:
+      return 0;
+    }
+  }
+
+  /// Bit i is set if the point is outside of enabled plane i.
+  inline unsigned outcode(const Point3DH<T>& p) const
+  {
+    unsigned code = 0;
+
+    for (int plane = 0; plane < PLANE_COUNT; ++plane)
+      if ((enabled & (1u << plane)) && distance(Plane(plane), p) < 0)
+        code |= 1u << plane;
+
+    return code;
+  }
+
+  inline bool contains(const Point3DH<T>& p) const
+  {
+    return outcode(p) == 0;
+  }
+
+  /// Sutherland-Hodgman clipping of a convex polygon in place. scratch is
+  /// reused between calls to avoid allocations. Returns false if less than
+  /// a triangle remains. Vertices are Point3DH<T> or any type with clipPosition() and
+  /// clipLerp() overloads.
+  template <typename V>
+  bool clipPolygon(std::vector<V>& polygon, std::vector<V>& scratch) const
+  {
+    unsigned any = 0;
+    unsigned all = ~0u;
+
+    for (const auto& p : polygon)
+    {
+      unsigned code = outcode(clipPosition(p));
+      any |= code;
+      all &= code;
+    }
+
+    // trivially rejected or accepted
+    if (all || polygon.empty())
+      return false;
+
+    if (!any)
+      return true;
+
+    // near plane first, the others are only meaningful for w > 0
+    static const Plane order[] =
+    {
+      NEAR_PLANE, FAR_PLANE, LEFT, RIGHT, BOTTOM, TOP
+    };
+
+    for (auto plane : order)
+    {
+      if (!(any & (1u << plane)))
+        continue;
+
+      scratch.clear();
+      const V *S = &polygon.back();
+      T dS = distance(plane, clipPosition(*S));
+
+      for (const auto& P : polygon)
+      {
+        T dP = distance(plane, clipPosition(P));
+
+        if (dP >= 0)
+        {
+          if (dS < 0)
+            scratch.push_back(clipLerp(*S, P, dS / (dS - dP)));
+
+          scratch.push_back(P);
+        }
+        else if (dS >= 0)
+        {
+          scratch.push_back(clipLerp(*S, P, dS / (dS - dP)));
+        }
+
+        S = &P;
+        dS = dP;
+      }
+
+      polygon.swap(scratch);
+
+      if (polygon.size() < 3)
+        return false;
+    }
+
+    return true;
+  }
+
+  /// Clip a line segment in place. Returns false if nothing remains.
+  bool clipLine(Point3DH<T>& a, Point3DH<T>& b) const
+  {
+    unsigned codeA = outcode(a);
+    unsigned codeB = outcode(b);
+
+    if (codeA & codeB)
+      return false;
+
+    if (!(codeA | codeB))
+      return true;
+
+    T t0 = 0, t1 = 1;
+
+    for (int plane = 0; plane < PLANE_COUNT; ++plane)
+    {
+      if (!((codeA | codeB) & (1u << plane)))
+        continue;
+
+      T dA = distance(Plane(plane), a);
+      T dB = distance(Plane(plane), b);
+      T t = dA / (dA - dB);
+
+      if (dA < 0)
+        t0 = std::max(t0, t);
+      else
+        t1 = std::min(t1, t);
+
+      if (t0 > t1)
+        return false;
+    }
+
+    Point3DH<T> start = clipLerp(a, b, t0);
+    b = clipLerp(a, b, t1);
+    a = start;
+    return true;
+  }
+
+}; // end class ClipVolume
+
+} // end namespace Utils
@@ -2,6 +2,7 @@
 
 #include <GL/glut.h>
 #include <string>
+#include "Render.h"
 
 namespace Utils
 {
@@ -122,19 +123,29 @@ public:
     return a;
   }
 
+  inline bool operator==(const Color& other) const
+  {
+    return r == other.r && g == other.g && b == other.b && a == other.a;
+  }
+
+  inline bool operator!=(const Color& other) const
+  {
+    return !(*this == other);
+  }
+
   // Set active OpenGL color.
   inline void setGLColor() const
   {
-    glColor4ub(r, g, b, a);
+    renderColor4ub(r, g, b, a);
   }
 
   // Set OpenGL clear color.
   inline void setGLClearColor() const
   {
-    glClearColor(static_cast<GLclampf>(r) / 255,
-                 static_cast<GLclampf>(g) / 255,
-                 static_cast<GLclampf>(b) / 255,
-                 static_cast<GLclampf>(a) / 255);
+    renderClearColor(static_cast<GLclampf>(r) / 255,
+                     static_cast<GLclampf>(g) / 255,
+                     static_cast<GLclampf>(b) / 255,
+                     static_cast<GLclampf>(a) / 255);
   }
 
 }; // end class Color
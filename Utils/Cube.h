@@ -5,6 +5,7 @@
 #include "Point2D.h"
 #include "Point3D.h"
 #include "Color.h"
+#include "ClipVolume.h"
 
 namespace Utils
 {
@@ -20,6 +21,7 @@ public:
   GLfloat pointSize = 8.0;
   Color pointColor = RED;
   Color color = BLACK;
+  ClipVolume<T> clipper;
 
   // unit cube at origin
   Cube()
@@ -141,46 +143,81 @@ public:
   void draw(const Matrix<T>& proj) const
   {
     this->color.setGLColor();
-    glLineWidth(this->lineWidth);
+    renderLineWidth(this->lineWidth);
 
-    for (const auto& face : this->faces)
-    {
-      glBegin(GL_LINE_STRIP);
+    renderBegin(GL_LINES);
 
-      for (const auto& point : face)
-        glVertex2<T>(point->transformed(proj).normalized2D());
+    std::vector<Point3DH<T>> projected;
 
-      glEnd();
+    for (const auto& face : this->faces)
+    {
+      // skip faces completely outside any plane before clipping edges
+      projected.clear();
+      unsigned outside = ~0u;
+
+      for (const auto& vertex : face)
+      {
+        projected.push_back(vertex->transformed(proj));
+        outside &= this->clipper.outcode(projected.back());
+      }
+
+      if (outside)
+        continue;
+
+      for (size_t i = 1; i < projected.size(); ++i)
+      {
+        auto a = projected[i - 1];
+        auto b = projected[i];
+
+        if (this->clipper.clipLine(a, b))
+        {
+          glVertex2<T>(a.normalized2D());
+          glVertex2<T>(b.normalized2D());
+        }
+      }
     }
+
+    renderEnd();
   }
 
   void drawPoints(const Matrix<T>& proj) const
   {
     this->pointColor.setGLColor();
-    glPointSize(this->pointSize);
+    renderPointSize(this->pointSize);
 
-    glBegin(GL_POINTS);
+    renderBegin(GL_POINTS);
 
     for (const auto& point : this->pointsContainer)
-      glVertex2<T>(point.transformed(proj).normalized2D());
+    {
+      auto p = point.transformed(proj);
 
-    glEnd();
+      if (this->clipper.contains(p))
+        glVertex2<T>(p.normalized2D());
+    }
+
+    renderEnd();
   }
 
   void drawEdges(const Matrix<T>& proj) const
   {
     this->color.setGLColor();
-    glLineWidth(this->lineWidth);
+    renderLineWidth(this->lineWidth);
+
+    renderBegin(GL_LINES);
 
     for (const auto& edge : this->edges)
     {
-      glBegin(GL_LINES);
+      auto a = edge[0]->transformed(proj);
+      auto b = edge[1]->transformed(proj);
 
-      for (const auto& point : edge)
-        glVertex2<T>(point->transformed(proj).normalized2D());
-
-      glEnd();
+      if (this->clipper.clipLine(a, b))
+      {
+        glVertex2<T>(a.normalized2D());
+        glVertex2<T>(b.normalized2D());
+      }
     }
+
+    renderEnd();
   }
 
   virtual ~Cube()
@@ -0,0 +1,250 @@
+#pragma once
+
+#include <GL/freeglut.h>
+#include <algorithm>
+#include "Render.h"
+
+namespace Utils
+{
+
+// ----------------------------------------------------------------------------
+// Damaged parts of the window, for redrawing only what changed. Widgets add
+// the window rectangles they changed, anything else damages the whole
+// window. A display function framed by beginFrame() and endFrame() starts
+// from a copy of the last frame kept in a texture and is scissored to the
+// union of the damage, so only those pixels are drawn again.
+// ----------------------------------------------------------------------------
+class Damage
+{
+private:
+  struct State
+  {
+    bool all = true;
+    GLint left = 0;
+    GLint bottom = 0;
+    GLint right = 0;
+    GLint top = 0;
+
+    bool framing = false;
+    bool partial = false;
+    GLint viewport[4] = { 0, 0, 0, 0 };
+
+    // copy of the last frame
+    GLuint texture = 0;
+    GLint textureWidth = 0;
+    GLint textureHeight = 0;
+    GLint width = 0;
+    GLint height = 0;
+
+    size_t fullFrames = 0;
+    size_t partialFrames = 0;
+  };
+
+  static State& state()
+  {
+    static State s;
+    return s;
+  }
+
+  static GLint powerOfTwo(GLint n)
+  {
+    GLint p = 1;
+
+    while (p < n)
+      p *= 2;
+
+    return p;
+  }
+
+  /// Draw the cached frame over the whole viewport.
+  static void restore()
+  {
+    auto& s = state();
+    GLfloat u = static_cast<GLfloat>(s.width) / s.textureWidth;
+    GLfloat v = static_cast<GLfloat>(s.height) / s.textureHeight;
+
+    // x, y, s, t per corner
+    const GLfloat vertices[] =
+    {
+      0, 0, 0, 0,
+      1, 0, u, 0,
+      1, 1, u, v,
+      0, 1, 0, v
+    };
+
+    glPushAttrib(GL_ENABLE_BIT | GL_TEXTURE_BIT | GL_CURRENT_BIT);
+    glPushClientAttrib(GL_CLIENT_VERTEX_ARRAY_BIT);
+    glMatrixMode(GL_PROJECTION);
+    glPushMatrix();
+    glLoadIdentity();
+    glOrtho(0, 1, 0, 1, -1, 1);
+    glMatrixMode(GL_MODELVIEW);
+    glPushMatrix();
+    glLoadIdentity();
+
+    glDisable(GL_BLEND);
+    glDisable(GL_DEPTH_TEST);
+    glDisable(GL_LIGHTING);
+    glDisable(GL_POLYGON_STIPPLE);
+    glEnable(GL_TEXTURE_2D);
+    glBindTexture(GL_TEXTURE_2D, s.texture);
+    glTexEnvi(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_REPLACE);
+
+    glEnableClientState(GL_VERTEX_ARRAY);
+    glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+    glVertexPointer(2, GL_FLOAT, 4 * sizeof(GLfloat), vertices);
+    glTexCoordPointer(2, GL_FLOAT, 4 * sizeof(GLfloat), vertices + 2);
+    glDrawArrays(GL_QUADS, 0, 4);
+
+    glMatrixMode(GL_PROJECTION);
+    glPopMatrix();
+    glMatrixMode(GL_MODELVIEW);
+    glPopMatrix();
+    glPopClientAttrib();
+    glPopAttrib();
+  }
+
+  /// Copy a rectangle of the viewport into the cached frame.
+  static void store(GLint x, GLint y, GLint width, GLint height)
+  {
+    auto& s = state();
+
+    glPushAttrib(GL_TEXTURE_BIT);
+
+    if (!s.texture)
+      glGenTextures(1, &s.texture);
+
+    glBindTexture(GL_TEXTURE_2D, s.texture);
+
+    if (s.width != s.viewport[2] || s.height != s.viewport[3])
+    {
+      s.width = s.viewport[2];
+      s.height = s.viewport[3];
+      s.textureWidth = powerOfTwo(s.width);
+      s.textureHeight = powerOfTwo(s.height);
+      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+      glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB8, s.textureWidth,
+                   s.textureHeight, 0, GL_RGB, GL_UNSIGNED_BYTE, nullptr);
+    }
+
+    glCopyTexSubImage2D(GL_TEXTURE_2D, 0, x, y, s.viewport[0] + x,
+                        s.viewport[1] + y, width, height);
+    glPopAttrib();
+  }
+
+public:
+  /// Damage a window rectangle, right and top exclusive.
+  static void add(GLint left, GLint bottom, GLint right, GLint top)
+  {
+    auto& s = state();
+
+    if (left >= right || bottom >= top)
+      return;
+
+    if (s.left >= s.right)
+    {
+      s.left = left;
+      s.bottom = bottom;
+      s.right = right;
+      s.top = top;
+      return;
+    }
+
+    s.left = std::min(s.left, left);
+    s.bottom = std::min(s.bottom, bottom);
+    s.right = std::max(s.right, right);
+    s.top = std::max(s.top, top);
+  }
+
+  /// Damage the whole window.
+  static inline void addAll()
+  {
+    state().all = true;
+  }
+
+  /// True if anything needs to be drawn again.
+  static inline bool pending()
+  {
+    const auto& s = state();
+    return s.all || s.left < s.right;
+  }
+
+  /// Start a frame. With only widget damage the last frame is restored and
+  /// drawing is scissored to the damage, otherwise the frame is drawn
+  /// completely. Recorded frames are always complete.
+  static void beginFrame()
+  {
+    auto& s = state();
+    s.framing = true;
+    s.partial = false;
+
+    if (recordingBuffer())
+      return;
+
+    glGetIntegerv(GL_VIEWPORT, s.viewport);
+
+    // a frame nobody asked for, e.g. after an expose, is drawn completely
+    s.partial = !s.all && s.left < s.right && s.texture &&
+                s.width == s.viewport[2] && s.height == s.viewport[3];
+
+    if (!s.partial)
+    {
+      ++s.fullFrames;
+      return;
+    }
+
+    ++s.partialFrames;
+    s.left = std::max(s.left, 0);
+    s.bottom = std::max(s.bottom, 0);
+    s.right = std::min(s.right, s.width);
+    s.top = std::min(s.top, s.height);
+
+    restore();
+    glEnable(GL_SCISSOR_TEST);
+    glScissor(s.viewport[0] + s.left, s.viewport[1] + s.bottom,
+              std::max(s.right - s.left, 0), std::max(s.top - s.bottom, 0));
+  }
+
+  /// End a frame before swapping, keeping its pixels for the next one.
+  static void endFrame()
+  {
+    auto& s = state();
+
+    if (!s.framing)
+      return;
+
+    if (!recordingBuffer())
+    {
+      if (s.partial)
+      {
+        glDisable(GL_SCISSOR_TEST);
+
+        if (s.left < s.right && s.bottom < s.top)
+          store(s.left, s.bottom, s.right - s.left, s.top - s.bottom);
+      }
+      else
+      {
+        store(0, 0, s.viewport[2], s.viewport[3]);
+      }
+    }
+
+    s.framing = false;
+    s.all = false;
+    s.left = s.bottom = s.right = s.top = 0;
+  }
+
+  /// Frames drawn completely and scissored to widget damage.
+  static inline size_t getFullFrames()
+  {
+    return state().fullFrames;
+  }
+
+  static inline size_t getPartialFrames()
+  {
+    return state().partialFrames;
+  }
+
+}; // end class Damage
+
+} // end namespace Utils
@@ -0,0 +1,85 @@
+#pragma once
+
+#include "Matrix.h"
+#include "Render.h"
+
+namespace Utils
+{
+
+// ----------------------------------------------------------------------------
+// Retained geometry, like a GL display list. The draw calls of a build
+// function are recorded once, with their vertices already transformed, and
+// replayed from vertex arrays until the transform they were built for
+// changes or the list is invalidated.
+// ----------------------------------------------------------------------------
+template <typename T>
+class DisplayList
+{
+private:
+  CommandBuffer buffer;
+  GLVertexArrayBackend backend;
+  Matrix<T> transform;
+  bool valid = false;
+  size_t builds = 0;
+
+  template <typename F>
+  void compile(F build)
+  {
+    buffer.clear();
+    buffer.record();
+    build();
+    buffer.stop();
+    valid = true;
+    ++builds;
+  }
+
+public:
+  DisplayList() : transform(0, 0) {}
+
+  virtual ~DisplayList()
+  {}
+
+  /// Draw geometry that depends on transform, rebuilding it with build()
+  /// when transform differs from the last one.
+  template <typename F>
+  void draw(const Matrix<T>& transform, F build)
+  {
+    if (!valid || transform != this->transform)
+    {
+      this->transform = transform;
+      this->compile(build);
+    }
+
+    buffer.replay(backend);
+  }
+
+  /// Draw geometry that never changes, built on first use.
+  template <typename F>
+  void draw(F build)
+  {
+    if (!valid)
+      this->compile(build);
+
+    buffer.replay(backend);
+  }
+
+  /// Rebuild on the next draw.
+  inline void invalidate()
+  {
+    valid = false;
+  }
+
+  inline bool isValid() const
+  {
+    return valid;
+  }
+
+  /// Times the geometry was built.
+  inline size_t getBuilds() const
+  {
+    return builds;
+  }
+
+}; // end class DisplayList
+
+} // end namespace Utils
@@ -218,55 +218,55 @@ public:
   /// Draw Ellipse with OpenGL calls.
   void draw() const
   {
-    glLineWidth(lineWidth);
+    renderLineWidth(lineWidth);
     color.setGLColor();
 
     if (filled)
-      glBegin(GL_POLYGON);
+      renderBegin(GL_POLYGON);
     else
-      glBegin(GL_LINE_LOOP);
+      renderBegin(GL_LINE_LOOP);
 
     for (const auto& point : pointsContainer)
     {
       glVertex2<T>(point);
     }
 
-    glEnd();
+    renderEnd();
   }
 
   /// Draw Ellipse's polygon points.
   void drawPoints() const
   {
-    glPointSize(pointSize);
+    renderPointSize(pointSize);
     pointColor.setGLColor();
 
-    glBegin(GL_POINTS);
+    renderBegin(GL_POINTS);
 
     for (const auto& point : pointsContainer)
     {
       glVertex2<T>(point);
     }
 
-    glEnd();
+    renderEnd();
   }
 
   /// Draw center point.
   void drawCenterPoint() const
   {
-    glPointSize(pointSize);
+    renderPointSize(pointSize);
     centrePointColor.setGLColor();
-    glBegin(GL_POINTS);
+    renderBegin(GL_POINTS);
     glVertex2<T>(centre);
-    glEnd();
+    renderEnd();
   }
 
   /// Draw all diagonals of Ellipse's polygon.
   void drawDiagonals() const
   {
-    glLineWidth(lineWidth);
+    renderLineWidth(lineWidth);
     color.setGLColor();
 
-    glBegin(GL_LINES);
+    renderBegin(GL_LINES);
 
     for (size_t i = 0; i < points; i++)
     {
@@ -277,7 +277,7 @@ public:
       }
     }
 
-    glEnd();
+    renderEnd();
   }
 
   /// Draw evolvents from this ellipse.
@@ -285,7 +285,7 @@ public:
   /// m: draw until this point. Depends on value of member variable "points".
   void drawEvolvents(size_t n, double m) const
   {
-    glLineWidth(lineWidth);
+    renderLineWidth(lineWidth);
     color.setGLColor();
 
     double gap = 2 * PI / points;
@@ -300,7 +300,7 @@ public:
     {
       alpha = j * gap2;
 
-      glBegin(GL_LINE_STRIP);
+      renderBegin(GL_LINE_STRIP);
 
       for (double i = 0; i <= m; i++)
       {
@@ -310,7 +310,7 @@ public:
                                 cy + ry * (sin(at) - theta * cos(at))));
       }
 
-      glEnd();
+      renderEnd();
     }
   }
 
@@ -0,0 +1,229 @@
+#pragma once
+
+#include <cmath>
+#include <vector>
+
+namespace Utils
+{
+
+// ----------------------------------------------------------------------------
+// Forward differencing evaluator for Bezier curves, sampled at equal steps of
+// the parameter. A polynomial of degree n has constant n-th differences, so
+// once a table of its differences is seeded every further sample costs n
+// additions per coordinate. Rounding errors in the table grow with the number
+// of steps, faster for higher degrees; the accuracy guard compares with de
+// Casteljau every few samples and seeds the table again when the curve has
+// drifted.
+// ----------------------------------------------------------------------------
+class ForwardDifferences
+{
+private:
+  std::vector<double> cx;
+  std::vector<double> cy;
+
+  // differences of increasing order at the current sample
+  std::vector<double> dx;
+  std::vector<double> dy;
+
+  // scratch space of de Casteljau
+  std::vector<double> sx;
+  std::vector<double> sy;
+
+  double step = 0.01;
+  size_t index = 0;
+  size_t guard = 0;
+  size_t sinceCheck = 0;
+  double tolerance = 0.01;
+  size_t reseeds = 0;
+
+  // differences of the control points and numbers of surjections, used
+  // while seeding
+  std::vector<double> wx;
+  std::vector<double> wy;
+  std::vector<double> surjections;
+
+  /// Seed the table at the current sample. Differencing n + 1 exact points
+  /// would cancel most digits for small steps, so the table is built from
+  /// the Taylor coefficients at t0 instead: with the curve written as
+  /// q(s) = sum b_k s^k in steps s, its j-th difference at 0 is
+  /// sum b_k j! S(k, j), where j! S(k, j) counts the surjections of k onto
+  /// j elements. b_k comes from the k-th differences of the control points.
+  void seed()
+  {
+    const size_t n = cx.size();
+    const double t0 = this->t();
+    wx = cx;
+    wy = cy;
+    surjections.assign(n, 0.0);
+    surjections[0] = 1.0;
+
+    for (size_t j = 0; j < n; j++)
+      dx[j] = dy[j] = 0.0;
+
+    double factor = 1.0;
+
+    for (size_t k = 0; k < n; k++)
+    {
+      // b_k = C(n - 1, k) h^k times the curve of the k-th differences
+      const size_t m = n - k;
+      sx.assign(wx.begin(), wx.begin() + m);
+      sy.assign(wy.begin(), wy.begin() + m);
+
+      for (size_t r = 1; r < m; r++)
+      {
+        for (size_t i = 0; i < m - r; i++)
+        {
+          sx[i] = (1 - t0) * sx[i] + t0 * sx[i + 1];
+          sy[i] = (1 - t0) * sy[i] + t0 * sy[i + 1];
+        }
+      }
+
+      const double bx = factor * sx[0];
+      const double by = factor * sy[0];
+
+      for (size_t j = 0; j <= k; j++)
+      {
+        dx[j] += bx * surjections[j];
+        dy[j] += by * surjections[j];
+      }
+
+      if (k + 1 == n)
+        break;
+
+      for (size_t i = 0; i + 1 < m; i++)
+      {
+        wx[i] = wx[i + 1] - wx[i];
+        wy[i] = wy[i + 1] - wy[i];
+      }
+
+      for (size_t j = k + 1; j > 0; j--)
+        surjections[j] = j * (surjections[j] + surjections[j - 1]);
+
+      surjections[0] = 0.0;
+      factor *= static_cast<double>(n - 1 - k) / (k + 1) * step;
+    }
+
+    sinceCheck = 0;
+  }
+
+public:
+  /// Start sampling a curve at t = 0 with the given step. guardInterval is
+  /// the number of samples between checks against de Casteljau, 0 turns the
+  /// guard off.
+  template <typename P>
+  void start(const std::vector<P>& controlPoints, double step,
+             size_t guardInterval = 0)
+  {
+    const size_t n = controlPoints.size();
+    cx.resize(n);
+    cy.resize(n);
+    dx.resize(n);
+    dy.resize(n);
+    sx.resize(n);
+    sy.resize(n);
+
+    for (size_t i = 0; i < n; i++)
+    {
+      cx[i] = static_cast<double>(controlPoints[i].x());
+      cy[i] = static_cast<double>(controlPoints[i].y());
+    }
+
+    this->step = step;
+    this->index = 0;
+    this->guard = guardInterval;
+    this->reseeds = 0;
+
+    if (n)
+      this->seed();
+  }
+
+  /// Largest distance from the exact curve the guard accepts.
+  inline void setTolerance(double tolerance)
+  {
+    this->tolerance = tolerance;
+  }
+
+  inline double x() const
+  {
+    return dx[0];
+  }
+
+  inline double y() const
+  {
+    return dy[0];
+  }
+
+  /// Parameter of the current sample.
+  inline double t() const
+  {
+    return index * step;
+  }
+
+  /// Advance to the next sample.
+  void next()
+  {
+    const size_t n = dx.size();
+    ++index;
+
+    if (n == 4)
+    {
+      // cubic curves, the common case
+      dx[0] += dx[1];
+      dx[1] += dx[2];
+      dx[2] += dx[3];
+      dy[0] += dy[1];
+      dy[1] += dy[2];
+      dy[2] += dy[3];
+    }
+    else
+    {
+      for (size_t k = 0; k + 1 < n; k++)
+      {
+        dx[k] += dx[k + 1];
+        dy[k] += dy[k + 1];
+      }
+    }
+
+    if (!guard || ++sinceCheck < guard)
+      return;
+
+    sinceCheck = 0;
+    double ex, ey;
+    this->exact(this->t(), ex, ey);
+
+    if (std::fabs(ex - dx[0]) > tolerance || std::fabs(ey - dy[0]) > tolerance)
+    {
+      this->seed();
+      ++reseeds;
+    }
+  }
+
+  /// Point of the curve at t by de Casteljau, without touching the table.
+  void exact(double t, double& x, double& y)
+  {
+    const size_t n = cx.size();
+    sx = cx;
+    sy = cy;
+
+    for (size_t r = 1; r < n; r++)
+    {
+      for (size_t i = 0; i < n - r; i++)
+      {
+        sx[i] = (1 - t) * sx[i] + t * sx[i + 1];
+        sy[i] = (1 - t) * sy[i] + t * sy[i + 1];
+      }
+    }
+
+    x = sx[0];
+    y = sy[0];
+  }
+
+  /// Times the guard seeded the table again since start().
+  inline size_t getReseeds() const
+  {
+    return reseeds;
+  }
+
+}; // end class ForwardDifferences
+
+} // end namespace Utils
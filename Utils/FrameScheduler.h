@@ -0,0 +1,115 @@
+#pragma once
+
+#include <algorithm>
+#include "Headless.h"
+
+namespace Utils
+{
+
+// ----------------------------------------------------------------------------
+// Fixed timestep loop on top of the GLUT timer. The update function runs
+// once per step of simulated time, however long frames take, so the
+// simulation runs at the same speed on every machine. Frames are paced by
+// timers, GLUT sleeps in between instead of spinning in the idle function.
+// The display function can interpolate with alpha(), the fraction of a step
+// that has passed since the last update.
+// ----------------------------------------------------------------------------
+class FrameScheduler
+{
+private:
+  struct State
+  {
+    void (*update)() = nullptr;
+    int step = 16;
+    int frameInterval = 16;
+    int budget = 250;
+    int last = 0;
+    int nextFrame = 0;
+    int accumulator = 0;
+    size_t updates = 0;
+
+    // timers of an earlier start() are ignored
+    int generation = 0;
+    bool running = false;
+  };
+
+  static State& state()
+  {
+    static State s;
+    return s;
+  }
+
+  static void tick(int generation)
+  {
+    auto& s = state();
+
+    if (!s.running || generation != s.generation)
+      return;
+
+    // a long stall is not caught up completely, the simulation slows down
+    // instead of trying to run ever more updates per frame
+    int now = Headless::elapsedTime();
+    s.accumulator += std::min(now - s.last, s.budget);
+    s.last = now;
+
+    while (s.accumulator >= s.step)
+    {
+      s.update();
+      s.accumulator -= s.step;
+      ++s.updates;
+    }
+
+    Headless::postRedisplay();
+
+    // frames are due on a fixed grid, a late frame does not delay the rest
+    s.nextFrame += s.frameInterval;
+
+    if (s.nextFrame < now)
+      s.nextFrame = now;
+
+    Headless::timerFunc(static_cast<unsigned int>(s.nextFrame - now), tick,
+                        s.generation);
+  }
+
+public:
+  /// Run update every step ms and redraw every frameInterval ms.
+  static void start(int step, void (*update)(), int frameInterval = 16)
+  {
+    auto& s = state();
+    s.update = update;
+    s.step = std::max(step, 1);
+    s.frameInterval = std::max(frameInterval, 1);
+    s.last = Headless::elapsedTime();
+    s.nextFrame = s.last;
+    s.accumulator = 0;
+    s.running = true;
+    Headless::timerFunc(0, tick, ++s.generation);
+  }
+
+  static inline void stop()
+  {
+    state().running = false;
+  }
+
+  /// Most ms of simulated time caught up per frame.
+  static inline void setBudget(int ms)
+  {
+    state().budget = std::max(ms, 1);
+  }
+
+  /// Fraction of a step since the last update, in [0, 1).
+  static inline double alpha()
+  {
+    const auto& s = state();
+    return static_cast<double>(s.accumulator) / s.step;
+  }
+
+  /// Updates run so far.
+  static inline size_t getUpdates()
+  {
+    return state().updates;
+  }
+
+}; // end class FrameScheduler
+
+} // end namespace Utils
@@ -0,0 +1,249 @@
+#pragma once
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+#include "Point3D.h"
+
+namespace Utils
+{
+
+// ----------------------------------------------------------------------------
+// Half-edge connectivity of a polygon mesh, built in linear time from a face
+// list. Every face corner owns the half-edge leaving it; twins link the two
+// sides of an edge, so vertex rings and face neighbours are walked without
+// searching. Edges used by more than two faces are left without twins.
+// ----------------------------------------------------------------------------
+template <typename T>
+class HalfEdgeMesh
+{
+private:
+  typedef Point3DH<T> point_t;
+
+  std::unordered_map<const point_t *, uint32_t> vertexIndex;
+  bool manifold = true;
+
+  static inline uint64_t key(uint32_t from, uint32_t to)
+  {
+    return (static_cast<uint64_t>(from) << 32) | to;
+  }
+
+public:
+  static const uint32_t none = 0xffffffff;
+
+  struct HalfEdge
+  {
+    uint32_t origin;
+    uint32_t face;
+    uint32_t next;
+    uint32_t prev;
+    uint32_t twin;
+  };
+
+  std::vector<HalfEdge> halfEdges;
+
+  /// One outgoing half-edge per vertex, a boundary one if there is any.
+  std::vector<uint32_t> vertexEdge;
+
+  /// First half-edge of every face.
+  std::vector<uint32_t> faceEdge;
+
+  /// Vertex of every index.
+  std::vector<const point_t *> vertices;
+
+  HalfEdgeMesh() {}
+
+  /// Build from any face container whose elements hold a vertices vector
+  /// of point pointers, such as Mesh<T>::faces.
+  template <typename Faces>
+  void build(const Faces& faces)
+  {
+    this->clear();
+
+    size_t cornerCount = 0;
+
+    for (const auto& face : faces)
+      cornerCount += face.vertices.size();
+
+    halfEdges.reserve(cornerCount);
+    faceEdge.reserve(faces.size());
+    vertexIndex.reserve(cornerCount);
+
+    std::unordered_map<uint64_t, uint32_t> edgeIndex;
+    edgeIndex.reserve(cornerCount);
+
+    // half-edges of every face -----------------------------------------------
+    for (const auto& face : faces)
+    {
+      auto first = static_cast<uint32_t>(halfEdges.size());
+      auto size = static_cast<uint32_t>(face.vertices.size());
+      auto faceIndex = static_cast<uint32_t>(faceEdge.size());
+      faceEdge.push_back(first);
+
+      for (uint32_t i = 0; i < size; ++i)
+      {
+        auto inserted = vertexIndex.emplace(
+                          face.vertices[i],
+                          static_cast<uint32_t>(vertices.size()));
+
+        if (inserted.second)
+        {
+          vertices.push_back(face.vertices[i]);
+          vertexEdge.push_back(none);
+        }
+
+        HalfEdge edge;
+        edge.origin = inserted.first->second;
+        edge.face = faceIndex;
+        edge.next = first + (i + 1) % size;
+        edge.prev = first + (i + size - 1) % size;
+        edge.twin = none;
+        halfEdges.push_back(edge);
+      }
+    }
+
+    // register directed edges, a direction seen twice is non-manifold -------
+    for (uint32_t h = 0; h < halfEdges.size(); ++h)
+    {
+      if (!edgeIndex.emplace(key(halfEdges[h].origin, this->destination(h)),
+                             h).second)
+        manifold = false;
+    }
+
+    // pair twins --------------------------------------------------------------
+    for (uint32_t h = 0; h < halfEdges.size(); ++h)
+    {
+      auto& edge = halfEdges[h];
+
+      if (edge.twin == none)
+      {
+        auto from = edge.origin;
+        auto to = this->destination(h);
+        auto self = edgeIndex.find(key(from, to));
+        auto other = edgeIndex.find(key(to, from));
+
+        if (self->second == h && other != edgeIndex.end() &&
+            halfEdges[other->second].twin == none)
+        {
+          edge.twin = other->second;
+          halfEdges[other->second].twin = h;
+        }
+      }
+
+      // prefer boundary edges, rings are walked from there
+      if (vertexEdge[edge.origin] == none || edge.twin == none)
+        vertexEdge[edge.origin] = h;
+    }
+  }
+
+  void clear()
+  {
+    halfEdges.clear();
+    vertexEdge.clear();
+    faceEdge.clear();
+    vertices.clear();
+    vertexIndex.clear();
+    manifold = true;
+  }
+
+  inline bool empty() const
+  {
+    return halfEdges.empty();
+  }
+
+  /// False if an edge is shared by more than two faces or used twice in
+  /// the same direction.
+  inline bool isManifold() const
+  {
+    return manifold;
+  }
+
+  /// Index of a vertex, or none if no face uses it.
+  inline uint32_t indexOf(const point_t *vertex) const
+  {
+    auto it = vertexIndex.find(vertex);
+    return it == vertexIndex.end() ? none : it->second;
+  }
+
+  inline uint32_t destination(uint32_t h) const
+  {
+    return halfEdges[halfEdges[h].next].origin;
+  }
+
+  inline bool isBoundary(uint32_t h) const
+  {
+    return halfEdges[h].twin == none;
+  }
+
+  inline bool isBoundaryVertex(uint32_t v) const
+  {
+    return vertexEdge[v] == none || isBoundary(vertexEdge[v]);
+  }
+
+  /// Calls f(h) for every half-edge leaving vertex v.
+  template <typename F>
+  void forEachOutgoing(uint32_t v, F f) const
+  {
+    uint32_t start = vertexEdge[v];
+    uint32_t h = start;
+
+    // the guard protects against broken rings around non-manifold vertices
+    for (size_t guard = 0; h != none && guard < halfEdges.size(); ++guard)
+    {
+      f(h);
+      h = halfEdges[halfEdges[h].prev].twin;
+
+      if (h == start)
+        break;
+    }
+  }
+
+  /// Calls f(u) for every vertex u sharing an edge with vertex v.
+  template <typename F>
+  void forEachNeighbour(uint32_t v, F f) const
+  {
+    uint32_t last = none;
+
+    this->forEachOutgoing(v, [&](uint32_t h)
+    {
+      f(this->destination(h));
+      last = halfEdges[h].prev;
+    });
+
+    // an open ring also reaches the vertex across its last incoming edge
+    if (last != none && isBoundary(last))
+      f(halfEdges[last].origin);
+  }
+
+  /// Calls f(g) for every face g sharing an edge with face index.
+  template <typename F>
+  void forEachFaceNeighbour(uint32_t face, F f) const
+  {
+    uint32_t start = faceEdge[face];
+    uint32_t h = start;
+
+    do
+    {
+      if (halfEdges[h].twin != none)
+        f(halfEdges[halfEdges[h].twin].face);
+
+      h = halfEdges[h].next;
+    }
+    while (h != start);
+  }
+
+  /// Calls f(h) once per edge, h being either of its half-edges.
+  template <typename F>
+  void forEachEdge(F f) const
+  {
+    for (uint32_t h = 0; h < halfEdges.size(); ++h)
+      if (halfEdges[h].twin == none || h < halfEdges[h].twin)
+        f(h);
+  }
+
+}; // end class HalfEdgeMesh
+
+template <typename T>
+const uint32_t HalfEdgeMesh<T>::none;
+
+} // end namespace Utils
@@ -0,0 +1,297 @@
+#pragma once
+
+#include <GL/freeglut.h>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "Color.h"
+#include "Damage.h"
+#include "Render.h"
+#include "SoftwareRenderer.h"
+
+namespace Utils
+{
+
+// ----------------------------------------------------------------------------
+// Offscreen mode for the GLUT programs. Started with
+//
+//   --headless [frames]   render frames (default 60) without a window
+//   --output <prefix>     write <prefix>_0000.ppm ..., "" writes nothing
+//
+// the display function is recorded into a CommandBuffer every frame and
+// rasterized by the SoftwareBackend. Time is simulated, every frame advances
+// the clock by frameTime ms and fires due timers and the idle function, so
+// runs are reproducible. Without the flag all calls forward to GLUT.
+// Bitmap text and line stipple are not drawn offscreen.
+// ----------------------------------------------------------------------------
+class Headless
+{
+private:
+  struct Timer
+  {
+    int due;
+    void (*callback)(int);
+    int value;
+  };
+
+  struct State
+  {
+    bool active = false;
+    size_t frames = 60;
+    int frameTime = 16;
+    int now = 0;
+    std::string output = "frame";
+    GLsizei width = 0;
+    GLsizei height = 0;
+    void (*display)() = nullptr;
+    void (*idle)() = nullptr;
+    void (*close)() = nullptr;
+    std::vector<Timer> timers;
+  };
+
+  static State& state()
+  {
+    static State s;
+    return s;
+  }
+
+  /// Remove count arguments starting at i.
+  static void consume(int& argc, char **argv, int i, int count)
+  {
+    for (int k = i; k + count <= argc; ++k)
+      argv[k] = argv[k + count];
+
+    argc -= count;
+  }
+
+  /// Run the callbacks of all timers due by now, in due order.
+  static void fireTimers()
+  {
+    auto& s = state();
+
+    while (true)
+    {
+      size_t next = s.timers.size();
+
+      for (size_t i = 0; i < s.timers.size(); ++i)
+        if (s.timers[i].due <= s.now &&
+            (next == s.timers.size() || s.timers[i].due < s.timers[next].due))
+          next = i;
+
+      if (next == s.timers.size())
+        break;
+
+      Timer timer = s.timers[next];
+      s.timers.erase(s.timers.begin() + next);
+      timer.callback(timer.value);
+    }
+  }
+
+public:
+  /// Take the headless options out of argv, true if headless was asked for.
+  static bool parse(int& argc, char **argv)
+  {
+    auto& s = state();
+
+    for (int i = 1; i < argc;)
+    {
+      if (std::strcmp(argv[i], "--headless") == 0)
+      {
+        s.active = true;
+        int count = 1;
+
+        if (i + 1 < argc && argv[i + 1][0] >= '0' && argv[i + 1][0] <= '9')
+        {
+          s.frames = std::strtoul(argv[i + 1], nullptr, 10);
+          count = 2;
+        }
+
+        consume(argc, argv, i, count);
+      }
+      else if (std::strcmp(argv[i], "--output") == 0 && i + 1 < argc)
+      {
+        s.output = argv[i + 1];
+        consume(argc, argv, i, 2);
+      }
+      else
+      {
+        ++i;
+      }
+    }
+
+    return s.active;
+  }
+
+  static inline bool active()
+  {
+    return state().active;
+  }
+
+  /// Simulated milliseconds per headless frame.
+  static inline void setFrameTime(int ms)
+  {
+    state().frameTime = ms;
+  }
+
+  /// glutInit and a double buffered RGB window, or the offscreen target.
+  static void createWindow(int& argc, char **argv, const char *title,
+                           GLsizei width, GLsizei height, int x = -1,
+                           int y = -1)
+  {
+    auto& s = state();
+    parse(argc, argv);
+    s.width = width;
+    s.height = height;
+
+    if (s.active)
+      return;
+
+    glutInit(&argc, argv);
+    glutInitDisplayMode(GLUT_DOUBLE | GLUT_RGB);
+    glutInitWindowSize(width, height);
+
+    if (x >= 0 && y >= 0)
+      glutInitWindowPosition(x, y);
+
+    glutCreateWindow(title);
+  }
+
+  static void displayFunc(void (*display)())
+  {
+    state().display = display;
+
+    if (!active())
+      glutDisplayFunc(display);
+  }
+
+  static void timerFunc(unsigned int ms, void (*callback)(int), int value)
+  {
+    auto& s = state();
+
+    if (s.active)
+      s.timers.push_back(Timer { s.now + static_cast<int>(ms), callback,
+                                 value });
+    else
+      glutTimerFunc(ms, callback, value);
+  }
+
+  static void idleFunc(void (*idle)())
+  {
+    state().idle = idle;
+
+    if (!active())
+      glutIdleFunc(idle);
+  }
+
+  static void closeFunc(void (*close)())
+  {
+    state().close = close;
+
+    if (!active())
+      glutCloseFunc(close);
+  }
+
+  /// Redraw the whole window. Headless frames are always redrawn.
+  static inline void postRedisplay()
+  {
+    Damage::addAll();
+
+    if (!active())
+      glutPostRedisplay();
+  }
+
+  /// Redraw what widgets reported as damaged, if anything.
+  static inline void postDamage()
+  {
+    if (!active() && Damage::pending())
+      glutPostRedisplay();
+  }
+
+  static inline void swapBuffers()
+  {
+    if (!active())
+      glutSwapBuffers();
+  }
+
+  /// Milliseconds since start, simulated when headless.
+  static inline int elapsedTime()
+  {
+    return active() ? state().now : glutGet(GLUT_ELAPSED_TIME);
+  }
+
+  /// glutMainLoop, or render the requested frames. Returns the exit code.
+  static int mainLoop()
+  {
+    auto& s = state();
+
+    if (!s.active)
+    {
+      glutMainLoop();
+      return 0;
+    }
+
+    if (!s.display)
+      return 1;
+
+    Framebuffer target(s.width, s.height);
+    SoftwareBackend backend(target, 0, s.width, 0, s.height);
+    CommandBuffer buffer;
+    double seconds = 0;
+    size_t vertices = 0;
+
+    for (size_t frame = 0; frame < s.frames; ++frame)
+    {
+      fireTimers();
+
+      if (s.idle)
+        s.idle();
+
+      auto start = std::chrono::steady_clock::now();
+      const GLclampf *clear = renderClearColor();
+      target.clear(Color(static_cast<int>(clear[0] * 255 + 0.5f),
+                         static_cast<int>(clear[1] * 255 + 0.5f),
+                         static_cast<int>(clear[2] * 255 + 0.5f),
+                         static_cast<int>(clear[3] * 255 + 0.5f)));
+
+      buffer.clear();
+      buffer.record();
+      s.display();
+      buffer.stop();
+      buffer.replay(backend);
+
+      seconds += std::chrono::duration<double>(
+                   std::chrono::steady_clock::now() - start).count();
+      vertices += buffer.vertexCount();
+
+      if (!s.output.empty())
+      {
+        char suffix[16];
+        std::snprintf(suffix, sizeof(suffix), "_%04u.ppm",
+                      static_cast<unsigned>(frame));
+
+        if (!target.writePPM(s.output + suffix))
+        {
+          std::cerr << "Could not write " << s.output + suffix << std::endl;
+          return 1;
+        }
+      }
+
+      s.now += s.frameTime;
+    }
+
+    if (s.close)
+      s.close();
+
+    std::cout << s.frames << " frames, " << vertices << " vertices, "
+              << (s.frames ? seconds * 1000 / s.frames : 0)
+              << " ms per frame" << std::endl;
+    return 0;
+  }
+
+}; // end class Headless
+
+} // end namespace Utils
@@ -0,0 +1,307 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+#include "Matrix.h"
+#include "Mesh.h"
+#include "Point3D.h"
+#include "Rectangle.h"
+
+namespace Utils
+{
+
+// ----------------------------------------------------------------------------
+// Software hierarchical depth buffer for occlusion culling.
+//
+// Large occluders are rasterized into a small depth buffer laid over the
+// viewport, depth being the homogeneous w (growing with the distance from
+// the eye). Every level of the pyramid keeps the farthest depth of the four
+// texels below it, so a box whose nearest point lies behind the stored depth
+// of all texels it covers is hidden. Each occluder triangle is written with
+// its farthest depth and only into texels it covers completely, which keeps
+// the test conservative.
+// ----------------------------------------------------------------------------
+template <typename T>
+class HiZBuffer
+{
+private:
+  typedef Point3DH<T> point_t;
+
+  struct Level
+  {
+    size_t width;
+    size_t height;
+    std::vector<float> depth;
+  };
+
+  Rectangle<T> viewport;
+  std::vector<Level> levels;
+  T nearW = 1e-5f;
+
+  std::vector<point_t> clipSpace;
+
+  static inline float edge(float ax, float ay, float bx, float by,
+                           float px, float py)
+  {
+    return (bx - ax) * (py - ay) - (by - ay) * (px - ax);
+  }
+
+  /// Viewport to buffer coordinates.
+  inline void toBuffer(const point_t& p, float& x, float& y) const
+  {
+    x = static_cast<float>((p.x() / p.w() - viewport.left()) /
+                           viewport.width() * levels[0].width);
+    y = static_cast<float>((p.y() / p.w() - viewport.bottom()) /
+                           viewport.height() * levels[0].height);
+  }
+
+  void rasterize(const point_t& a, const point_t& b, const point_t& c)
+  {
+    float ax, ay, bx, by, cx, cy;
+    toBuffer(a, ax, ay);
+    toBuffer(b, bx, by);
+    toBuffer(c, cx, cy);
+
+    float area = edge(ax, ay, bx, by, cx, cy);
+
+    if (area == 0)
+      return;
+
+    // either winding covers the same pixels
+    if (area < 0)
+    {
+      std::swap(bx, cx);
+      std::swap(by, cy);
+    }
+
+    auto& level = levels[0];
+    float depth = static_cast<float>(std::max(a.w(), std::max(b.w(), c.w())));
+
+    float minX = std::min(ax, std::min(bx, cx));
+    float minY = std::min(ay, std::min(by, cy));
+    float maxX = std::max(ax, std::max(bx, cx));
+    float maxY = std::max(ay, std::max(by, cy));
+
+    long x0 = std::max(0L, static_cast<long>(std::floor(minX)));
+    long y0 = std::max(0L, static_cast<long>(std::floor(minY)));
+    long x1 = std::min(static_cast<long>(level.width) - 1,
+                       static_cast<long>(std::ceil(maxX)));
+    long y1 = std::min(static_cast<long>(level.height) - 1,
+                       static_cast<long>(std::ceil(maxY)));
+
+    // a texel is covered completely if its corner farthest outside each
+    // edge is inside, i.e. its center lies inside by half the extent of
+    // the texel along the edge normal
+    float ab = 0.5f * (std::fabs(bx - ax) + std::fabs(by - ay));
+    float bc = 0.5f * (std::fabs(cx - bx) + std::fabs(cy - by));
+    float ca = 0.5f * (std::fabs(ax - cx) + std::fabs(ay - cy));
+
+    for (long y = y0; y <= y1; ++y)
+    {
+      float py = y + 0.5f;
+
+      for (long x = x0; x <= x1; ++x)
+      {
+        float px = x + 0.5f;
+
+        if (edge(ax, ay, bx, by, px, py) >= ab &&
+            edge(bx, by, cx, cy, px, py) >= bc &&
+            edge(cx, cy, ax, ay, px, py) >= ca)
+        {
+          float& stored = level.depth[y * level.width + x];
+          stored = std::min(stored, depth);
+        }
+      }
+    }
+  }
+
+public:
+  /// Statistics since the last clear().
+  size_t testedObjects = 0;
+  size_t culledObjects = 0;
+  size_t culledFaces = 0;
+
+  HiZBuffer(const Rectangle<T>& viewport, size_t width = 128,
+            size_t height = 128)
+    : viewport(viewport)
+  {
+    this->setViewport(viewport, width, height);
+  }
+
+  virtual ~HiZBuffer()
+  {}
+
+  /// Area of the screen covered and resolution of the finest level.
+  void setViewport(const Rectangle<T>& viewport, size_t width = 128,
+                   size_t height = 128)
+  {
+    this->viewport = viewport;
+    levels.clear();
+
+    width = std::max<size_t>(width, 1);
+    height = std::max<size_t>(height, 1);
+
+    while (true)
+    {
+      levels.push_back(Level { width, height, std::vector<float>() });
+
+      if (width == 1 && height == 1)
+        break;
+
+      width = (width + 1) / 2;
+      height = (height + 1) / 2;
+    }
+
+    this->clear();
+  }
+
+  /// Smallest w an occluder vertex may have, faces closer are skipped.
+  inline void setNear(T minW)
+  {
+    nearW = minW;
+  }
+
+  /// Forget all occluders and statistics.
+  void clear()
+  {
+    for (auto& level : levels)
+      level.depth.assign(level.width * level.height,
+                         std::numeric_limits<float>::infinity());
+
+    testedObjects = 0;
+    culledObjects = 0;
+    culledFaces = 0;
+  }
+
+  /// Rasterize the faces of a mesh as occluder. projtrans takes the mesh
+  /// into clip space, before the perspective divide.
+  void addOccluder(Mesh<T>& mesh, const Matrix<T>& projtrans)
+  {
+    const auto& he = mesh.connectivity();
+    clipSpace.clear();
+
+    for (const auto& vertex : he.vertices)
+      clipSpace.emplace_back(vertex->transformed(projtrans));
+
+    for (size_t f = 0; f < he.faceEdge.size(); ++f)
+    {
+      uint32_t first = he.faceEdge[f];
+      const auto& a = clipSpace[he.halfEdges[first].origin];
+      uint32_t h = he.halfEdges[first].next;
+      bool inFront = a.w() >= nearW;
+
+      // faces reaching behind the near plane are left out
+      for (uint32_t k = h; k != first && inFront; k = he.halfEdges[k].next)
+        inFront = clipSpace[he.halfEdges[k].origin].w() >= nearW;
+
+      if (!inFront)
+        continue;
+
+      // fan triangulation
+      for (uint32_t next = he.halfEdges[h].next; next != first;
+           h = next, next = he.halfEdges[next].next)
+        this->rasterize(a, clipSpace[he.halfEdges[h].origin],
+                        clipSpace[he.halfEdges[next].origin]);
+    }
+  }
+
+  /// Propagate the farthest depth up the pyramid, call after adding
+  /// occluders.
+  void buildPyramid()
+  {
+    for (size_t i = 1; i < levels.size(); ++i)
+    {
+      const auto& fine = levels[i - 1];
+      auto& coarse = levels[i];
+
+      for (size_t y = 0; y < coarse.height; ++y)
+      {
+        size_t y0 = 2 * y, y1 = std::min(2 * y + 1, fine.height - 1);
+
+        for (size_t x = 0; x < coarse.width; ++x)
+        {
+          size_t x0 = 2 * x, x1 = std::min(2 * x + 1, fine.width - 1);
+          coarse.depth[y * coarse.width + x] =
+            std::max(std::max(fine.depth[y0 * fine.width + x0],
+                              fine.depth[y0 * fine.width + x1]),
+                     std::max(fine.depth[y1 * fine.width + x0],
+                              fine.depth[y1 * fine.width + x1]));
+        }
+      }
+    }
+  }
+
+  /// True if the box between min and max, taken into clip space by
+  /// projtrans, is hidden behind the occluders. faceCount is only used for
+  /// the statistics.
+  bool isOccluded(const point_t& min, const point_t& max,
+                  const Matrix<T>& projtrans, size_t faceCount = 0)
+  {
+    ++testedObjects;
+
+    float x0 = std::numeric_limits<float>::max(), y0 = x0;
+    float x1 = -x0, y1 = -x0;
+    float nearest = std::numeric_limits<float>::max();
+
+    for (int corner = 0; corner < 8; ++corner)
+    {
+      point_t p(corner & 1 ? max.x() : min.x(),
+                corner & 2 ? max.y() : min.y(),
+                corner & 4 ? max.z() : min.z(), 1);
+      p.transform(projtrans);
+
+      // reaches the eye, can not be decided
+      if (p.w() < nearW)
+        return false;
+
+      float x, y;
+      toBuffer(p, x, y);
+      x0 = std::min(x0, x);
+      y0 = std::min(y0, y);
+      x1 = std::max(x1, x);
+      y1 = std::max(y1, y);
+      nearest = std::min(nearest, static_cast<float>(p.w()));
+    }
+
+    // covered texels of the finest level
+    long left = std::max(0L, static_cast<long>(std::floor(x0)));
+    long bottom = std::max(0L, static_cast<long>(std::floor(y0)));
+    long right = std::min(static_cast<long>(levels[0].width) - 1,
+                          static_cast<long>(std::floor(x1)));
+    long top = std::min(static_cast<long>(levels[0].height) - 1,
+                        static_cast<long>(std::floor(y1)));
+
+    // off screen, left to frustum culling
+    if (left > right || bottom > top)
+      return false;
+
+    // the level where the box covers at most 2x2 texels
+    size_t level = 0;
+
+    while (level + 1 < levels.size() &&
+           (right - left > 1 || top - bottom > 1))
+    {
+      left /= 2;
+      bottom /= 2;
+      right /= 2;
+      top /= 2;
+      ++level;
+    }
+
+    const auto& hiz = levels[level];
+
+    for (long y = bottom; y <= top; ++y)
+      for (long x = left; x <= right; ++x)
+        if (hiz.depth[y * hiz.width + x] >= nearest)
+          return false;
+
+    ++culledObjects;
+    culledFaces += faceCount;
+    return true;
+  }
+
+}; // end class HiZBuffer
+
+} // end namespace Utils
@@ -288,23 +288,23 @@ public:
   /// Draw Line with OpenGL calls.
   void draw() const
   {
-    glLineWidth(lineWidth);
+    renderLineWidth(lineWidth);
     color.setGLColor();
-    glBegin(GL_LINES);
+    renderBegin(GL_LINES);
     glVertex2<T>(pt1);
     glVertex2<T>(pt2);
-    glEnd();
+    renderEnd();
   }
 
   /// Draw Line's endpoints with OpenGL calls.
   void drawPoints() const
   {
-    glPointSize(pointSize);
+    renderPointSize(pointSize);
     pointsColor.setGLColor();
-    glBegin(GL_POINTS);
+    renderBegin(GL_POINTS);
     glVertex2<T>(pt1);
     glVertex2<T>(pt2);
-    glEnd();
+    renderEnd();
   }
 
   /// Prints line to a stream.
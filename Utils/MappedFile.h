@@ -0,0 +1,211 @@
+#pragma once
+
+#include <string>
+#include <cstddef>
+#include <cstdint>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace Utils
+{
+
+// ----------------------------------------------------------------------------
+// Read-only memory mapped file
+// ----------------------------------------------------------------------------
+class MappedFile
+{
+private:
+  const char *bytes = nullptr;
+  size_t length = 0;
+
+#ifdef _WIN32
+  HANDLE file = INVALID_HANDLE_VALUE;
+  HANDLE mapping = nullptr;
+#else
+  int file = -1;
+#endif
+
+public:
+  MappedFile() {}
+
+  MappedFile(const std::string& path)
+  {
+    this->open(path);
+  }
+
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  virtual ~MappedFile()
+  {
+    this->close();
+  }
+
+  /// Map the whole file. Returns false if it can not be opened.
+  bool open(const std::string& path)
+  {
+    this->close();
+
+#ifdef _WIN32
+    file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                       OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+
+    if (file == INVALID_HANDLE_VALUE)
+      return false;
+
+    LARGE_INTEGER fileSize;
+
+    if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0)
+    {
+      this->close();
+      return false;
+    }
+
+    mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+
+    if (!mapping)
+    {
+      this->close();
+      return false;
+    }
+
+    bytes = static_cast<const char *>(
+              MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+    length = static_cast<size_t>(fileSize.QuadPart);
+#else
+    file = ::open(path.c_str(), O_RDONLY);
+
+    if (file < 0)
+      return false;
+
+    struct stat info;
+
+    if (fstat(file, &info) != 0 || info.st_size == 0)
+    {
+      this->close();
+      return false;
+    }
+
+    length = static_cast<size_t>(info.st_size);
+    void *view = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, file, 0);
+
+    if (view == MAP_FAILED)
+    {
+      length = 0;
+      this->close();
+      return false;
+    }
+
+    // we parse front to back exactly once
+    madvise(view, length, MADV_SEQUENTIAL);
+    bytes = static_cast<const char *>(view);
+#endif
+
+    if (!bytes)
+    {
+      this->close();
+      return false;
+    }
+
+    return true;
+  }
+
+  /// Unmap and close the file.
+  void close()
+  {
+#ifdef _WIN32
+    if (bytes)
+      UnmapViewOfFile(bytes);
+
+    if (mapping)
+      CloseHandle(mapping);
+
+    if (file != INVALID_HANDLE_VALUE)
+      CloseHandle(file);
+
+    mapping = nullptr;
+    file = INVALID_HANDLE_VALUE;
+#else
+    if (bytes)
+      munmap(const_cast<char *>(bytes), length);
+
+    if (file >= 0)
+      ::close(file);
+
+    file = -1;
+#endif
+
+    bytes = nullptr;
+    length = 0;
+  }
+
+  inline bool isOpen() const
+  {
+    return bytes != nullptr;
+  }
+
+  inline const char *data() const
+  {
+    return bytes;
+  }
+
+  inline size_t size() const
+  {
+    return length;
+  }
+
+  inline const char *begin() const
+  {
+    return bytes;
+  }
+
+  inline const char *end() const
+  {
+    return bytes + length;
+  }
+
+}; // end class MappedFile
+
+// ----------------------------------------------------------------------------
+// Size and last modification time of a file, for telling whether a file
+// derived from it is stale. The time is in platform units and only meant to
+// be compared. Returns false if the file does not exist.
+// ----------------------------------------------------------------------------
+inline bool fileStamp(const std::string& path, uint64_t& size,
+                      int64_t& modified)
+{
+#ifdef _WIN32
+  WIN32_FILE_ATTRIBUTE_DATA info;
+
+  if (!GetFileAttributesExA(path.c_str(), GetFileExInfoStandard, &info))
+    return false;
+
+  size = (static_cast<uint64_t>(info.nFileSizeHigh) << 32) |
+         info.nFileSizeLow;
+  modified = static_cast<int64_t>(
+               (static_cast<uint64_t>(info.ftLastWriteTime.dwHighDateTime)
+                << 32) | info.ftLastWriteTime.dwLowDateTime);
+#else
+  struct stat info;
+
+  if (stat(path.c_str(), &info) != 0)
+    return false;
+
+  size = static_cast<uint64_t>(info.st_size);
+  modified = static_cast<int64_t>(info.st_mtime);
+#endif
+
+  return true;
+}
+
+} // end namespace Utils
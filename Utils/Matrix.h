@@ -96,6 +96,17 @@ public:
     }
   }
 
+  bool operator==(const Matrix<T>& rhs) const
+  {
+    return this->rows == rhs.rows && this->cols == rhs.cols &&
+           this->data == rhs.data;
+  }
+
+  inline bool operator!=(const Matrix<T>& rhs) const
+  {
+    return !(*this == rhs);
+  }
+
   Matrix<T>& operator*=(T factor)
   {
     for (size_t row = 0; row < this->rows; ++row)
@@ -315,8 +326,8 @@ protected:
 
   void updateTransform()
   {
-    this->data[2][0] = deltaX;
-    this->data[2][1] = deltaY;
+    this->data[3][0] = deltaX;
+    this->data[3][1] = deltaY;
     this->data[3][2] = deltaZ;
   }
 
@@ -365,7 +376,7 @@ public:
 
   inline T getDeltaZ() const
   {
-    return deltaY;
+    return deltaZ;
   }
 
 }; // end class Translate3D
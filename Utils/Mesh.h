@@ -2,8 +2,14 @@
 #include <vector>
 #include <string>
 #include <algorithm>
+#include <cstdint>
+#include <unordered_map>
 #include "Point3D.h"
 #include "Vector3D.h"
+#include "functions.h"
+#include "ClipVolume.h"
+#include "HalfEdge.h"
+#include "VertexCache.h"
 
 namespace Utils
 {
@@ -50,10 +56,228 @@ protected:
     face.centroid = std::move(point_t(x, y, z, 1));
   }
 
+  // clip space vertex with its Gouraud intensity
+  struct ShadedVertex
+  {
+    point_t position;
+    T shade;
+
+    friend inline const point_t& clipPosition(const ShadedVertex& v)
+    {
+      return v.position;
+    }
+
+    friend inline ShadedVertex clipLerp(const ShadedVertex& a,
+                                        const ShadedVertex& b, T t)
+    {
+      return ShadedVertex { clipLerp(a.position, b.position, t),
+                            a.shade + (b.shade - a.shade) * t };
+    }
+  };
+
+  // face that passed culling, with its per-frame data
+  struct VisibleFace
+  {
+    Face *face;
+    size_t first;
+    vector3D_t normal;
+    point_t centroid;
+  };
+
   point_t center;
   size_t segments;
   virtual void recalcPoints() = 0;
 
+  // per-frame buffers, kept to avoid reallocating every frame
+  std::vector<VisibleFace> visibleFaces;
+  std::vector<point_t> clipSpace;
+  std::vector<point_t> clipped;
+  std::vector<point_t> clipScratch;
+
+  // software post-transform cache of drawFaces, direct mapped on the vertex
+  // address so neighbouring vertices land in neighbouring slots
+  struct CachedTransform
+  {
+    const point_t *source;
+    point_t transformed;
+  };
+
+  static const size_t transformCacheSize = 64;
+  std::vector<CachedTransform> transformCache;
+  size_t transformHits = 0;
+  size_t transformMisses = 0;
+
+  inline const point_t& transformCached(const point_t *vertex,
+                                        const Matrix<T>& Tm)
+  {
+    auto slot = reinterpret_cast<uintptr_t>(vertex) / sizeof(point_t) %
+                transformCacheSize;
+    auto& entry = transformCache[slot];
+
+    if (entry.source == vertex)
+    {
+      ++transformHits;
+    }
+    else
+    {
+      ++transformMisses;
+      entry.source = vertex;
+      entry.transformed = vertex->transformed(Tm);
+    }
+
+    return entry.transformed;
+  }
+
+  /// Faces as vertex indices of the connectivity.
+  void indexFaces(std::vector<uint32_t>& indices,
+                  std::vector<uint32_t>& faceStarts)
+  {
+    const auto& he = this->connectivity();
+    indices.clear();
+    faceStarts.assign(1, 0);
+
+    for (size_t f = 0; f < this->faces.size(); ++f)
+    {
+      auto first = he.faceEdge[f];
+
+      for (size_t k = 0; k < this->faces[f].vertices.size(); ++k)
+        indices.push_back(he.halfEdges[first + k].origin);
+
+      faceStarts.push_back(static_cast<uint32_t>(indices.size()));
+    }
+  }
+
+  // adjacency, built on first use
+  HalfEdgeMesh<T> halfEdges;
+  bool halfEdgesValid = false;
+
+  // unique edges with the faces on either side, for wireframes
+  struct Edge
+  {
+    uint32_t a, b;
+    uint32_t left, right;
+  };
+
+  std::vector<Edge> edges;
+  std::vector<char> frontFacing;
+  std::vector<point_t> vertexClipSpace;
+
+  // smooth shading, normals indexed like the connectivity's vertices
+  std::vector<vector3D_t> vertexNormals;
+  std::vector<T> vertexShades;
+  Matrix<T> shadedRotation = Matrix<T>(4, 4);
+  point_t shadedLight;
+  bool shadesValid = false;
+  std::vector<ShadedVertex> shadedPolygon;
+  std::vector<ShadedVertex> shadedScratch;
+
+  /// Must be called whenever faces are rebuilt or vertices move.
+  inline void invalidateConnectivity()
+  {
+    halfEdgesValid = false;
+    halfEdges.clear();
+    edges.clear();
+    vertexNormals.clear();
+    shadesValid = false;
+  }
+
+  /// Average the normals of the faces around every vertex.
+  void buildVertexNormals()
+  {
+    const auto& he = this->connectivity();
+    vertexNormals.assign(he.vertices.size(), vector3D_t());
+
+    for (const auto& edge : he.halfEdges)
+      vertexNormals[edge.origin] += this->faces[edge.face].normal;
+
+    for (auto& normal : vertexNormals)
+      if (normal.lengthSquared() > 0)
+        normal.normalize();
+  }
+
+  /// Light every vertex, unless rotation and light are unchanged since the
+  /// last call.
+  void updateShades(const Matrix<T>& rot, const point_t& lightSource)
+  {
+    if (shadesValid && rot == shadedRotation &&
+        lightSource.x() == shadedLight.x() &&
+        lightSource.y() == shadedLight.y() &&
+        lightSource.z() == shadedLight.z())
+      return;
+
+    if (vertexNormals.empty())
+      this->buildVertexNormals();
+
+    const auto& he = this->connectivity();
+    vertexShades.resize(he.vertices.size());
+
+    for (size_t i = 0; i < he.vertices.size(); ++i)
+    {
+      vector3D_t f(he.vertices[i]->transformed(rot), lightSource);
+      f.normalize();
+
+      auto normal = vertexNormals[i].transformed(rot);
+      vertexShades[i] = (vector3D_t::dotProduct(f, normal) + 1) / 2;
+    }
+
+    shadedRotation = rot;
+    shadedLight = lightSource;
+    shadesValid = true;
+  }
+
+  void buildEdges()
+  {
+    const auto& he = this->connectivity();
+    edges.clear();
+
+    he.forEachEdge([&](uint32_t h)
+    {
+      const auto& edge = he.halfEdges[h];
+      uint32_t right = edge.twin == he.none ?
+                       he.none : he.halfEdges[edge.twin].face;
+      edges.push_back(Edge
+      {
+        edge.origin, he.destination(h), edge.face, right
+      });
+    });
+  }
+
+  /// Draw every edge once in a single batch, skipping edges whose faces
+  /// all face away.
+  void drawEdgeList(const Matrix<T>& Tm)
+  {
+    if (edges.empty())
+      this->buildEdges();
+
+    const auto& he = this->connectivity();
+    vertexClipSpace.clear();
+
+    for (const auto& vertex : he.vertices)
+      vertexClipSpace.emplace_back(vertex->transformed(Tm));
+
+    edgeColor.setGLColor();
+    renderLineWidth(lineWidth);
+    renderBegin(GL_LINES);
+
+    for (const auto& edge : edges)
+    {
+      if (!frontFacing[edge.left] &&
+          (edge.right == he.none || !frontFacing[edge.right]))
+        continue;
+
+      auto a = vertexClipSpace[edge.a];
+      auto b = vertexClipSpace[edge.b];
+
+      if (clipper.clipLine(a, b))
+      {
+        glVertex2<T>(a.normalized2D());
+        glVertex2<T>(b.normalized2D());
+      }
+    }
+
+    renderEnd();
+  }
+
 public:
   std::vector<std::vector<point_t>> points;
   std::vector<Face> faces;
@@ -69,6 +293,9 @@ public:
   bool drawNormals = false;
   bool drawPoints = false;
   bool backfaceCull = true;
+  bool smooth = false;
+  bool cacheOptimized = false;
+  ClipVolume<T> clipper;
 
   Mesh(size_t segments = 16, std::string label = "Mesh")
     : center(0, 0, 0), segments(segments), label(label)
@@ -84,6 +311,10 @@ public:
   {
     this->segments++;
     this->recalcPoints();
+    this->invalidateConnectivity();
+
+    if (cacheOptimized)
+      this->optimizeFaceOrder();
   }
 
   /// Decrease segments.
@@ -91,70 +322,279 @@ public:
   {
     this->segments--;
     this->recalcPoints();
+    this->invalidateConnectivity();
+
+    if (cacheOptimized)
+      this->optimizeFaceOrder();
+  }
+
+  /// Average cache miss ratio of the face order for a FIFO cache.
+  double getACMR(size_t cacheSize = 16)
+  {
+    std::vector<uint32_t> indices, faceStarts;
+    this->indexFaces(indices, faceStarts);
+    return acmr(indices, faceStarts, halfEdges.vertices.size(), cacheSize);
+  }
+
+  /// Reorder faces so consecutive faces share vertices (Tipsify).
+  void optimizeFaceOrder(size_t cacheSize = 16)
+  {
+    std::vector<uint32_t> indices, faceStarts;
+    this->indexFaces(indices, faceStarts);
+    auto order = tipsify(indices, faceStarts, halfEdges.vertices.size(),
+                         cacheSize);
+
+    std::vector<Face> reordered;
+    reordered.reserve(this->faces.size());
+
+    for (auto f : order)
+      reordered.push_back(std::move(this->faces[f]));
+
+    this->faces.swap(reordered);
+    this->invalidateConnectivity();
+  }
+
+  /// Store all vertices in one row, sorted along a Morton curve so that
+  /// vertices close in space are close in memory. Faces are updated.
+  void sortVerticesMorton()
+  {
+    std::vector<const point_t *> sources;
+
+    for (const auto& row : this->points)
+      for (const auto& vertex : row)
+        sources.push_back(&vertex);
+
+    if (sources.empty())
+      return;
+
+    T lower[3] = { sources[0]->x(), sources[0]->y(), sources[0]->z() };
+    T upper[3] = { lower[0], lower[1], lower[2] };
+
+    for (auto p : sources)
+    {
+      T xyz[3] = { p->x(), p->y(), p->z() };
+
+      for (int i = 0; i < 3; ++i)
+      {
+        lower[i] = std::min(lower[i], xyz[i]);
+        upper[i] = std::max(upper[i], xyz[i]);
+      }
+    }
+
+    T extent = std::max(upper[0] - lower[0],
+                        std::max(upper[1] - lower[1], upper[2] - lower[2]));
+
+    if (extent <= 0)
+      extent = 1;
+
+    std::vector<std::pair<uint64_t, const point_t *>> keyed;
+    keyed.reserve(sources.size());
+
+    for (auto p : sources)
+      keyed.emplace_back(mortonCode((p->x() - lower[0]) / extent,
+                                    (p->y() - lower[1]) / extent,
+                                    (p->z() - lower[2]) / extent), p);
+
+    std::sort(keyed.begin(), keyed.end(),
+              [](const std::pair<uint64_t, const point_t *>& a,
+                 const std::pair<uint64_t, const point_t *>& b)
+    {
+      return a.first < b.first;
+    });
+
+    std::vector<point_t> sorted;
+    std::unordered_map<const point_t *, size_t> newIndex;
+    sorted.reserve(keyed.size());
+    newIndex.reserve(keyed.size());
+
+    for (const auto& entry : keyed)
+    {
+      newIndex[entry.second] = sorted.size();
+      sorted.push_back(*entry.second);
+    }
+
+    std::vector<std::vector<point_t>> rows(1);
+    rows[0].swap(sorted);
+
+    for (auto& face : this->faces)
+      for (auto& vertex : face.vertices)
+        vertex = &rows[0][newIndex[vertex]];
+
+    this->points.swap(rows);
+    this->invalidateConnectivity();
+  }
+
+  /// Vertex transforms served by the post-transform cache in the last
+  /// drawFaces() call.
+  inline size_t getTransformHits() const
+  {
+    return transformHits;
+  }
+
+  /// Vertex transforms computed in the last drawFaces() call.
+  inline size_t getTransformMisses() const
+  {
+    return transformMisses;
+  }
+
+  /// Half-edge connectivity of the current faces, built on first call.
+  const HalfEdgeMesh<T>& connectivity()
+  {
+    if (!halfEdgesValid)
+    {
+      halfEdges.build(this->faces);
+      halfEdgesValid = true;
+    }
+
+    return halfEdges;
   }
 
   void drawVertices(const Matrix<T>& projtrans) const
   {
-    glPointSize(this->pointSize);
+    renderPointSize(this->pointSize);
     this->pointColor.setGLColor();
 
-    glBegin(GL_POINTS);
+    renderBegin(GL_POINTS);
 
     for (const auto& row : this->points)
+    {
       for (const auto& vertex : row)
-        glVertex2<T>(vertex.transformed(projtrans).normalized2D());
+      {
+        auto p = vertex.transformed(projtrans);
 
-    glEnd();
+        if (clipper.contains(p))
+          glVertex2<T>(p.normalized2D());
+      }
+    }
+
+    renderEnd();
   }
 
   void drawFaces(const Matrix<T>& proj, const Matrix<T>& rot,
                  const point_t& projCenter, const point_t& lightSource)
   {
-    std::vector<Face *> facesToDraw;
+    auto Tm = proj * rot;
+
+    // a wireframe without fill does not depend on drawing order, so its
+    // edges go out deduplicated in one batch after culling
+    bool batchEdges = drawEdges && !filled;
+
+    visibleFaces.clear();
+    clipSpace.clear();
+    frontFacing.assign(this->faces.size(), 1);
+    transformCache.assign(transformCacheSize,
+                          CachedTransform { nullptr, point_t() });
+    transformHits = 0;
+    transformMisses = 0;
 
-    if (backfaceCull)
+    for (size_t i = 0; i < this->faces.size(); ++i)
     {
-      for (auto& face : this->faces)
-      {
-        auto normal = face.normal.transformed(rot);
-        auto centroid = face.centroid.transformed(rot);
+      auto& face = this->faces[i];
+      auto normal = face.normal.transformed(rot);
+      auto centroid = face.centroid.transformed(rot);
 
-        // backface culling
+      // backface culling
+      if (backfaceCull)
+      {
         vector3D_t s(centroid, projCenter);
         s.normalize();
 
-        // add to visible faces
-        if (vector3D_t::dotProduct(s, normal) > 0)
-          facesToDraw.emplace_back(&face);
+        if (vector3D_t::dotProduct(s, normal) <= 0)
+        {
+          frontFacing[i] = 0;
+          continue;
+        }
       }
-    }
-    else
-    {
-      for (auto& face : this->faces)
-        facesToDraw.emplace_back(&face);
+
+      // transform into clip space, drop faces completely outside any plane
+      size_t first = clipSpace.size();
+      unsigned outside = ~0u;
+
+      for (const auto& vertex : face.vertices)
+      {
+        clipSpace.push_back(this->transformCached(vertex, Tm));
+        outside &= clipper.outcode(clipSpace.back());
+      }
+
+      if (outside)
+      {
+        clipSpace.resize(first);
+        continue;
+      }
+
+      // add to visible faces
+      visibleFaces.push_back(VisibleFace { &face, first, normal, centroid });
     }
 
     // order visible faces by their centroid's Z coordinate
-    std::sort(facesToDraw.begin(), facesToDraw.end(),
-              [&rot](const Face * a, const Face * b)
+    std::sort(visibleFaces.begin(), visibleFaces.end(),
+              [](const VisibleFace & a, const VisibleFace & b)
     {
-      return a->centroid.transformed(rot).z() < b->centroid.transformed(rot).z();
+      return a.centroid.z() < b.centroid.z();
     });
 
+    // Gouraud shading lights vertices, not faces
+    bool gouraud = filled && smooth;
+
+    if (gouraud)
+      this->updateShades(rot, lightSource);
+
     // draw visible faces
-    for (const auto& face : facesToDraw)
+    std::vector<point2D_t> transformedPoints;
+
+    for (const auto& visible : visibleFaces)
     {
-      auto Tm = proj * rot;
+      auto vertexCount = visible.face->vertices.size();
+      auto begin = clipSpace.begin() + visible.first;
+      transformedPoints.clear();
+
+      // clip between projection and perspective divide
+      if (gouraud)
+      {
+        const auto& he = halfEdges;
+        auto corner = he.faceEdge[visible.face - this->faces.data()];
+        shadedPolygon.clear();
+
+        for (size_t i = 0; i < vertexCount; ++i)
+        {
+          auto shade = vertexShades[he.halfEdges[corner + i].origin];
+          shadedPolygon.push_back(ShadedVertex { *(begin + i), shade });
+        }
 
-      std::vector<point2D_t> transformedPoints;
+        if (!clipper.clipPolygon(shadedPolygon, shadedScratch))
+          continue;
 
-      for (const auto& vertex : face->vertices)
-        transformedPoints.emplace_back(vertex->transformed(Tm).normalized2D());
+        for (const auto& vertex : shadedPolygon)
+          transformedPoints.emplace_back(vertex.position.normalized2D());
+      }
+      else
+      {
+        clipped.assign(begin, begin + vertexCount);
+
+        if (!clipper.clipPolygon(clipped, clipScratch))
+          continue;
+
+        for (const auto& vertex : clipped)
+          transformedPoints.emplace_back(vertex.normalized2D());
+      }
 
-      auto normal = face->normal.transformed(rot);
-      auto centroid = face->centroid.transformed(rot);
+      const auto& normal = visible.normal;
+      const auto& centroid = visible.centroid;
 
-      if (filled)
+      if (gouraud)
+      {
+        renderBegin(GL_POLYGON);
+
+        for (size_t i = 0; i < transformedPoints.size(); ++i)
+        {
+          auto shade = static_cast<GLfloat>(shadedPolygon[i].shade);
+          renderColor3f(shade, shade, shade);
+          glVertex2<T>(transformedPoints[i]);
+        }
+
+        renderEnd();
+      }
+      else if (filled)
       {
         vector3D_t f(centroid, lightSource);
         f.normalize();
@@ -162,33 +602,30 @@ public:
         auto dp = static_cast<GLfloat>(
                     (vector3D_t::dotProduct(f, normal) + 1) / 2);
 
-        glColor3f(dp, dp, dp);
+        renderColor3f(dp, dp, dp);
 
-        glBegin(GL_POLYGON);
+        renderBegin(GL_POLYGON);
 
         for (const auto& vertex : transformedPoints)
           glVertex2<T>(vertex);
 
-        glEnd();
+        renderEnd();
       }
 
-      if (drawEdges)
+      if (drawEdges && !batchEdges)
       {
         edgeColor.setGLColor();
-        glLineWidth(lineWidth);
+        renderLineWidth(lineWidth);
 
-        glBegin(GL_LINE_STRIP);
+        // GL_LINE_LOOP is broken on linux, so the strip repeats the first
+        // vertex to close the outline
+        renderBegin(GL_LINE_STRIP);
 
         for (const auto& vertex : transformedPoints)
           glVertex2<T>(vertex);
 
-        glEnd();
-
-        // GL_LINE_LOOP is broken on linux, so we draw last line manually
-        glBegin(GL_LINE_STRIP);
-        glVertex2<T>(transformedPoints.back());
         glVertex2<T>(transformedPoints.front());
-        glEnd();
+        renderEnd();
       }
 
       if (drawNormals)
@@ -199,27 +636,41 @@ public:
           centroid.z() + normal.z() * 0.1
         );
 
-        this->normalColor.setGLColor();
-        glBegin(GL_LINES);
-        glVertex2<T>(centroid.transformed(proj).normalized2D());
-        glVertex2<T>(endpoint.transformed(proj).normalized2D());
-        glEnd();
+        auto a = centroid.transformed(proj);
+        auto b = endpoint.transformed(proj);
+
+        if (clipper.clipLine(a, b))
+        {
+          this->normalColor.setGLColor();
+          renderBegin(GL_LINES);
+          glVertex2<T>(a.normalized2D());
+          glVertex2<T>(b.normalized2D());
+          renderEnd();
+        }
       }
 
       if (drawPoints)
       {
-        glPointSize(this->pointSize);
+        renderPointSize(this->pointSize);
         this->pointColor.setGLColor();
-        glBegin(GL_POINTS);
+        renderBegin(GL_POINTS);
 
-        for (const auto& vertex : transformedPoints)
-          glVertex2<T>(vertex);
+        // only original vertices, not the ones created by clipping
+        for (auto it = begin; it != begin + vertexCount; ++it)
+          if (clipper.contains(*it))
+            glVertex2<T>(it->normalized2D());
 
-        glEnd();
+        renderEnd();
       }
     }
+
+    if (batchEdges)
+      this->drawEdgeList(Tm);
   }
 
 }; // end class Mesh
 
+template <typename T>
+const size_t Mesh<T>::transformCacheSize;
+
 } // end namespace Utils
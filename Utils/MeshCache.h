@@ -0,0 +1,318 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "Mesh.h"
+#include "MappedFile.h"
+
+namespace Utils
+{
+
+// ----------------------------------------------------------------------------
+// Binary mesh cache file layout (native byte order)
+//
+//   header     MeshCacheHeader, padded to MeshCacheHeader::alignment
+//   vertices   double[3 * vertexCount]
+//   faceStarts uint32_t[faceCount + 1], first index of each face
+//   indices    uint32_t[indexCount]
+//   normals    double[3 * faceCount]
+//   centroids  double[3 * faceCount]
+//
+// Every array starts on an alignment boundary. The checksum is FNV-1a over
+// everything after the padded header. The header records the size and
+// modification time of the file the mesh was loaded from, so a cache older
+// than its source is rebuilt.
+// ----------------------------------------------------------------------------
+struct MeshCacheHeader
+{
+  static const uint32_t currentVersion = 2;
+  static const uint32_t byteOrderMark = 0x01020304;
+  static const size_t alignment = 64;
+
+  char magic[4];
+  uint32_t version;
+  uint32_t byteOrder;
+  uint32_t reserved;
+  uint64_t vertexCount;
+  uint64_t faceCount;
+  uint64_t indexCount;
+  uint64_t vertexOffset;
+  uint64_t faceStartOffset;
+  uint64_t indexOffset;
+  uint64_t normalOffset;
+  uint64_t centroidOffset;
+  uint64_t fileSize;
+  uint64_t checksum;
+  uint64_t sourceSize;
+  int64_t sourceTime;
+};
+
+// ----------------------------------------------------------------------------
+// 64 bit FNV-1a hash
+// ----------------------------------------------------------------------------
+inline uint64_t fnv1a(const char *data, size_t size)
+{
+  uint64_t hash = 14695981039346656037ULL;
+
+  for (size_t i = 0; i < size; ++i)
+  {
+    hash ^= static_cast<unsigned char>(data[i]);
+    hash *= 1099511628211ULL;
+  }
+
+  return hash;
+}
+
+// ----------------------------------------------------------------------------
+// Read-only view of a mapped mesh cache file. Accessors point straight into
+// the mapping, nothing is copied.
+// ----------------------------------------------------------------------------
+class MeshCache
+{
+private:
+  MappedFile file;
+  const MeshCacheHeader *header = nullptr;
+
+  template <typename U>
+  inline const U *at(uint64_t offset) const
+  {
+    return reinterpret_cast<const U *>(file.data() + offset);
+  }
+
+  /// True if count elements of the given size fit into the file at an
+  /// aligned offset. Compared by division, so huge counts can not wrap.
+  bool inBounds(uint64_t offset, uint64_t count, uint64_t size) const
+  {
+    return offset % MeshCacheHeader::alignment == 0 &&
+           offset <= file.size() && count <= (file.size() - offset) / size;
+  }
+
+public:
+  MeshCache() {}
+
+  MeshCache(const std::string& path)
+  {
+    this->open(path);
+  }
+
+  /// Map a cache file, validate its header and verify the checksum. The
+  /// file is never modified.
+  bool open(const std::string& path)
+  {
+    this->close();
+
+    if (!file.open(path) || file.size() < sizeof(MeshCacheHeader))
+    {
+      this->close();
+      return false;
+    }
+
+    auto h = at<MeshCacheHeader>(0);
+    const uint64_t xyz = 3 * sizeof(double);
+
+    bool valid = std::memcmp(h->magic, "BGMC", 4) == 0 &&
+                 h->version == MeshCacheHeader::currentVersion &&
+                 h->byteOrder == MeshCacheHeader::byteOrderMark &&
+                 h->fileSize == file.size() &&
+                 inBounds(h->vertexOffset, h->vertexCount, xyz) &&
+                 h->faceCount < std::numeric_limits<uint64_t>::max() &&
+                 inBounds(h->faceStartOffset, h->faceCount + 1,
+                          sizeof(uint32_t)) &&
+                 inBounds(h->indexOffset, h->indexCount, sizeof(uint32_t)) &&
+                 inBounds(h->normalOffset, h->faceCount, xyz) &&
+                 inBounds(h->centroidOffset, h->faceCount, xyz) &&
+                 fnv1a(file.data() + h->vertexOffset,
+                       file.size() - h->vertexOffset) == h->checksum;
+
+    if (!valid)
+    {
+      this->close();
+      return false;
+    }
+
+    header = h;
+    return true;
+  }
+
+  void close()
+  {
+    file.close();
+    header = nullptr;
+  }
+
+  /// True if the cache was written from the file at sourcePath as it is
+  /// now.
+  bool matchesSource(const std::string& sourcePath) const
+  {
+    uint64_t size;
+    int64_t modified;
+
+    return fileStamp(sourcePath, size, modified) &&
+           size == header->sourceSize && modified == header->sourceTime;
+  }
+
+  inline bool isOpen() const
+  {
+    return header != nullptr;
+  }
+
+  inline size_t getVertexCount() const
+  {
+    return static_cast<size_t>(header->vertexCount);
+  }
+
+  inline size_t getFaceCount() const
+  {
+    return static_cast<size_t>(header->faceCount);
+  }
+
+  inline size_t getIndexCount() const
+  {
+    return static_cast<size_t>(header->indexCount);
+  }
+
+  inline size_t getFileSize() const
+  {
+    return file.size();
+  }
+
+  /// xyz triplets, one per vertex.
+  inline const double *vertices() const
+  {
+    return at<double>(header->vertexOffset);
+  }
+
+  /// Face i uses indices[faceStarts[i]] .. indices[faceStarts[i + 1] - 1].
+  inline const uint32_t *faceStarts() const
+  {
+    return at<uint32_t>(header->faceStartOffset);
+  }
+
+  inline const uint32_t *indices() const
+  {
+    return at<uint32_t>(header->indexOffset);
+  }
+
+  /// xyz triplets, one per face.
+  inline const double *normals() const
+  {
+    return at<double>(header->normalOffset);
+  }
+
+  /// xyz triplets, one per face.
+  inline const double *centroids() const
+  {
+    return at<double>(header->centroidOffset);
+  }
+
+}; // end class MeshCache
+
+// ----------------------------------------------------------------------------
+// Write a mesh into a cache file, stamped with the file it was loaded from if
+// sourcePath is given. Returns false if the file can not be written.
+// ----------------------------------------------------------------------------
+template <typename T>
+bool writeMeshCache(const Mesh<T>& mesh, const std::string& path,
+                    const std::string& sourcePath = std::string())
+{
+  const size_t align = MeshCacheHeader::alignment;
+
+  auto padded = [align](size_t size)
+  {
+    return (size + align - 1) / align * align;
+  };
+
+  // number all vertices row by row
+  std::unordered_map<const Point3DH<T> *, uint32_t> vertexIndex;
+  size_t vertexCount = 0;
+
+  for (const auto& row : mesh.points)
+    for (const auto& vertex : row)
+      vertexIndex[&vertex] = static_cast<uint32_t>(vertexCount++);
+
+  size_t indexCount = 0;
+
+  for (const auto& face : mesh.faces)
+    indexCount += face.vertices.size();
+
+  size_t faceCount = mesh.faces.size();
+
+  MeshCacheHeader header;
+  std::memset(&header, 0, sizeof(header));
+  std::memcpy(header.magic, "BGMC", 4);
+  header.version = MeshCacheHeader::currentVersion;
+  header.byteOrder = MeshCacheHeader::byteOrderMark;
+
+  if (!sourcePath.empty() &&
+      !fileStamp(sourcePath, header.sourceSize, header.sourceTime))
+    return false;
+
+  header.vertexCount = vertexCount;
+  header.faceCount = faceCount;
+  header.indexCount = indexCount;
+  header.vertexOffset = padded(sizeof(MeshCacheHeader));
+  header.faceStartOffset = header.vertexOffset +
+                           padded(vertexCount * 3 * sizeof(double));
+  header.indexOffset = header.faceStartOffset +
+                       padded((faceCount + 1) * sizeof(uint32_t));
+  header.normalOffset = header.indexOffset +
+                        padded(indexCount * sizeof(uint32_t));
+  header.centroidOffset = header.normalOffset +
+                          padded(faceCount * 3 * sizeof(double));
+  header.fileSize = header.centroidOffset +
+                    padded(faceCount * 3 * sizeof(double));
+
+  std::vector<char> buffer(static_cast<size_t>(header.fileSize), 0);
+
+  char *base = buffer.data();
+  auto vertices = reinterpret_cast<double *>(base + header.vertexOffset);
+
+  for (const auto& row : mesh.points)
+  {
+    for (const auto& vertex : row)
+    {
+      *vertices++ = vertex.x();
+      *vertices++ = vertex.y();
+      *vertices++ = vertex.z();
+    }
+  }
+
+  auto faceStarts = reinterpret_cast<uint32_t *>(base + header.faceStartOffset);
+  auto indices = reinterpret_cast<uint32_t *>(base + header.indexOffset);
+  auto normals = reinterpret_cast<double *>(base + header.normalOffset);
+  auto centroids = reinterpret_cast<double *>(base + header.centroidOffset);
+  uint32_t start = 0;
+
+  for (const auto& face : mesh.faces)
+  {
+    *faceStarts++ = start;
+
+    for (const auto& vertex : face.vertices)
+      indices[start++] = vertexIndex[vertex];
+
+    *normals++ = face.normal.x();
+    *normals++ = face.normal.y();
+    *normals++ = face.normal.z();
+    *centroids++ = face.centroid.x();
+    *centroids++ = face.centroid.y();
+    *centroids++ = face.centroid.z();
+  }
+
+  *faceStarts = start;
+
+  header.checksum = fnv1a(base + header.vertexOffset,
+                          buffer.size() - header.vertexOffset);
+  std::memcpy(base, &header, sizeof(header));
+
+  std::ofstream out(path, std::ios::binary | std::ios::trunc);
+  out.write(buffer.data(), buffer.size());
+  return static_cast<bool>(out);
+}
+
+} // end namespace Utils
@@ -0,0 +1,353 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "Color.h"
+#include "HiZBuffer.h"
+#include "Matrix.h"
+#include "Mesh.h"
+
+namespace Utils
+{
+
+// ----------------------------------------------------------------------------
+// Many copies of one mesh, each with its own transform and color. The
+// geometry is stored once; per instance only a matrix and a color are kept.
+// Instances are culled against the clip volume by their bounding sphere and
+// all visible faces are depth sorted together, so instances overlap
+// correctly. With an occlusion buffer attached, the nearest instances are
+// rasterized as occluders first and hidden instances skip the face
+// pipeline. Transforms should be rigid with uniform scale, normals are not
+// corrected for shearing.
+// ----------------------------------------------------------------------------
+template <typename T>
+class MeshInstances
+{
+private:
+  typedef Point3DH<T> point_t;
+  typedef Point2D<T> point2D_t;
+  typedef Vector3D<T> vector3D_t;
+
+  struct Instance
+  {
+    Matrix<T> transform;
+    Color color;
+    T scale;
+  };
+
+  // face that passed culling, its clipped outline lives in screen
+  struct VisibleFace
+  {
+    uint32_t instance;
+    uint32_t first;
+    uint32_t count;
+    T depth;
+    GLfloat shade;
+  };
+
+  std::shared_ptr<Mesh<T>> geometry;
+  std::vector<Instance> instances;
+
+  // bounding sphere and box of the geometry
+  point_t center;
+  T radius = 0;
+  point_t boundsMin;
+  point_t boundsMax;
+
+  // per-frame buffers, kept to avoid reallocating every frame
+  std::vector<point_t> clipSpace;
+  std::vector<point_t> clipped;
+  std::vector<point_t> clipScratch;
+  std::vector<point2D_t> screen;
+  std::vector<VisibleFace> visibleFaces;
+  std::vector<std::pair<T, size_t>> nearestFirst;
+  std::vector<char> occluder;
+  size_t drawnInstances = 0;
+
+  /// Rasterize the instances closest to the eye into the occlusion buffer.
+  void prepareOcclusion(const Matrix<T>& proj, const Matrix<T>& rot)
+  {
+    occlusion->clear();
+    occluder.assign(instances.size(), 0);
+    nearestFirst.clear();
+
+    for (size_t i = 0; i < instances.size(); ++i)
+    {
+      auto c = center.transformed(rot * instances[i].transform);
+      nearestFirst.emplace_back(-c.z(), i);
+    }
+
+    size_t count = std::min(occluderCount, nearestFirst.size());
+    std::partial_sort(nearestFirst.begin(), nearestFirst.begin() + count,
+                      nearestFirst.end());
+
+    for (size_t k = 0; k < count; ++k)
+    {
+      size_t i = nearestFirst[k].second;
+      occluder[i] = 1;
+      occlusion->addOccluder(*geometry,
+                             proj * rot * instances[i].transform);
+    }
+
+    occlusion->buildPyramid();
+  }
+
+  /// Conservative test of a sphere against the clip volume, using the
+  /// corners of its bounding cube.
+  bool outside(const Matrix<T>& proj, const point_t& c, T r) const
+  {
+    unsigned all = ~0u;
+
+    for (int corner = 0; corner < 8 && all; ++corner)
+    {
+      point_t p(c.x() + (corner & 1 ? r : -r),
+                c.y() + (corner & 2 ? r : -r),
+                c.z() + (corner & 4 ? r : -r), 1);
+      all &= clipper.outcode(p.transformed(proj));
+    }
+
+    return all != 0;
+  }
+
+public:
+  Color edgeColor = LIGHT_GRAY;
+  GLfloat lineWidth = 1.0;
+  bool drawEdges = false;
+  bool backfaceCull = true;
+  ClipVolume<T> clipper;
+
+  /// Optional occlusion buffer, covering the viewport the instances are
+  /// drawn into.
+  std::shared_ptr<HiZBuffer<T>> occlusion;
+
+  /// Number of nearest instances used as occluders.
+  size_t occluderCount = 8;
+
+  MeshInstances(std::shared_ptr<Mesh<T>> geometry)
+    : geometry(geometry), center(0, 0, 0, 1), boundsMin(0, 0, 0, 1),
+      boundsMax(0, 0, 0, 1)
+  {
+    this->updateBounds();
+  }
+
+  virtual ~MeshInstances()
+  {}
+
+  /// Recompute the bounding volumes, needed after the geometry changed.
+  void updateBounds()
+  {
+    const auto& rows = geometry->points;
+    T x = 0, y = 0, z = 0;
+    size_t count = 0;
+
+    for (const auto& row : rows)
+    {
+      for (const auto& p : row)
+      {
+        x += p.x();
+        y += p.y();
+        z += p.z();
+        ++count;
+      }
+    }
+
+    if (count)
+      center = point_t(x / count, y / count, z / count, 1);
+
+    radius = 0;
+    boundsMin = boundsMax = center;
+
+    for (const auto& row : rows)
+    {
+      for (const auto& p : row)
+      {
+        radius = std::max(radius, vector3D_t(center, p).length());
+        boundsMin = point_t(std::min(boundsMin.x(), p.x()),
+                            std::min(boundsMin.y(), p.y()),
+                            std::min(boundsMin.z(), p.z()), 1);
+        boundsMax = point_t(std::max(boundsMax.x(), p.x()),
+                            std::max(boundsMax.y(), p.y()),
+                            std::max(boundsMax.z(), p.z()), 1);
+      }
+    }
+  }
+
+  /// Add an instance, returns its index.
+  size_t add(const Matrix<T>& transform, const Color& color)
+  {
+    instances.push_back(Instance { transform, color, 1 });
+    this->setTransform(instances.size() - 1, transform);
+    return instances.size() - 1;
+  }
+
+  void setTransform(size_t i, const Matrix<T>& transform)
+  {
+    auto& instance = instances[i];
+    instance.transform = transform;
+
+    // largest axis scale, to grow the bounding sphere with the instance
+    instance.scale = 0;
+
+    for (size_t col = 0; col < 3; ++col)
+    {
+      vector3D_t axis(transform(0, col), transform(1, col), transform(2, col));
+      instance.scale = std::max(instance.scale, axis.length());
+    }
+  }
+
+  inline void setColor(size_t i, const Color& color)
+  {
+    instances[i].color = color;
+  }
+
+  inline const Matrix<T>& getTransform(size_t i) const
+  {
+    return instances[i].transform;
+  }
+
+  inline size_t size() const
+  {
+    return instances.size();
+  }
+
+  inline void clear()
+  {
+    instances.clear();
+  }
+
+  /// Instances that survived culling in the last draw() call.
+  inline size_t getDrawnInstances() const
+  {
+    return drawnInstances;
+  }
+
+  /// Draw all instances in one pass, with flat shading in instance colors.
+  void draw(const Matrix<T>& proj, const Matrix<T>& rot,
+            const point_t& projCenter, const point_t& lightSource)
+  {
+    const auto& he = geometry->connectivity();
+    const auto& faces = geometry->faces;
+
+    visibleFaces.clear();
+    screen.clear();
+    drawnInstances = 0;
+
+    if (occlusion)
+      this->prepareOcclusion(proj, rot);
+
+    for (size_t i = 0; i < instances.size(); ++i)
+    {
+      const auto& instance = instances[i];
+      auto M = rot * instance.transform;
+
+      // cull the whole instance
+      if (this->outside(proj, center.transformed(M), radius * instance.scale))
+        continue;
+
+      auto Tm = proj * M;
+
+      if (occlusion && !occluder[i] &&
+          occlusion->isOccluded(boundsMin, boundsMax, Tm, faces.size()))
+        continue;
+
+      ++drawnInstances;
+
+      // transform every shared vertex once
+      clipSpace.clear();
+
+      for (const auto& vertex : he.vertices)
+        clipSpace.emplace_back(vertex->transformed(Tm));
+
+      for (size_t f = 0; f < faces.size(); ++f)
+      {
+        const auto& face = faces[f];
+        auto normal = face.normal.transformed(M);
+        normal.normalize();
+        auto centroid = face.centroid.transformed(M);
+
+        // backface culling
+        if (backfaceCull)
+        {
+          vector3D_t s(centroid, projCenter);
+          s.normalize();
+
+          if (vector3D_t::dotProduct(s, normal) <= 0)
+            continue;
+        }
+
+        // clip the outline right away, only screen points are kept
+        auto corner = he.faceEdge[f];
+        clipped.clear();
+
+        for (size_t k = 0; k < face.vertices.size(); ++k)
+          clipped.push_back(clipSpace[he.halfEdges[corner + k].origin]);
+
+        if (!clipper.clipPolygon(clipped, clipScratch))
+          continue;
+
+        vector3D_t l(centroid, lightSource);
+        l.normalize();
+
+        VisibleFace visible;
+        visible.instance = static_cast<uint32_t>(i);
+        visible.first = static_cast<uint32_t>(screen.size());
+        visible.count = static_cast<uint32_t>(clipped.size());
+        visible.depth = centroid.z();
+        visible.shade = static_cast<GLfloat>(
+                          (vector3D_t::dotProduct(l, normal) + 1) / 2);
+        visibleFaces.push_back(visible);
+
+        for (const auto& vertex : clipped)
+          screen.emplace_back(vertex.normalized2D());
+      }
+    }
+
+    // order faces of all instances by depth
+    std::sort(visibleFaces.begin(), visibleFaces.end(),
+              [](const VisibleFace & a, const VisibleFace & b)
+    {
+      return a.depth < b.depth;
+    });
+
+    renderLineWidth(lineWidth);
+
+    for (const auto& visible : visibleFaces)
+    {
+      const auto& color = instances[visible.instance].color;
+      auto begin = screen.begin() + visible.first;
+      auto end = begin + visible.count;
+
+      renderColor3f(color.red() / 255.0f * visible.shade,
+                    color.green() / 255.0f * visible.shade,
+                    color.blue() / 255.0f * visible.shade);
+
+      renderBegin(GL_POLYGON);
+
+      for (auto it = begin; it != end; ++it)
+        glVertex2<T>(*it);
+
+      renderEnd();
+
+      if (drawEdges)
+      {
+        edgeColor.setGLColor();
+
+        // GL_LINE_LOOP is broken on linux, so the strip repeats the first
+        // vertex to close the outline
+        renderBegin(GL_LINE_STRIP);
+
+        for (auto it = begin; it != end; ++it)
+          glVertex2<T>(*it);
+
+        glVertex2<T>(*begin);
+        renderEnd();
+      }
+    }
+  }
+
+}; // end class MeshInstances
+
+} // end namespace Utils
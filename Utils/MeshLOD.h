@@ -0,0 +1,551 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <queue>
+#include <unordered_map>
+#include <vector>
+#include "Matrix.h"
+#include "Mesh.h"
+#include "Model.h"
+
+namespace Utils
+{
+
+// ----------------------------------------------------------------------------
+// Chain of levels of detail for a mesh, built with quadric error metric edge
+// collapses (Garland-Heckbert). Level 0 is the original mesh, every further
+// level has about ratio times the triangles of the previous one.
+// ----------------------------------------------------------------------------
+template <typename T>
+class MeshLOD
+{
+private:
+  typedef Point3DH<T> point_t;
+
+  // symmetric 4x4 matrix, upper triangle row by row
+  struct Quadric
+  {
+    double q[10];
+
+    Quadric()
+    {
+      std::fill(q, q + 10, 0.0);
+    }
+
+    void addPlane(double a, double b, double c, double d, double weight = 1)
+    {
+      q[0] += weight * a * a;
+      q[1] += weight * a * b;
+      q[2] += weight * a * c;
+      q[3] += weight * a * d;
+      q[4] += weight * b * b;
+      q[5] += weight * b * c;
+      q[6] += weight * b * d;
+      q[7] += weight * c * c;
+      q[8] += weight * c * d;
+      q[9] += weight * d * d;
+    }
+
+    Quadric& operator+=(const Quadric& other)
+    {
+      for (int i = 0; i < 10; ++i)
+        q[i] += other.q[i];
+
+      return *this;
+    }
+
+    double evaluate(const double p[3]) const
+    {
+      double x = p[0], y = p[1], z = p[2];
+      return q[0] * x * x + 2 * q[1] * x * y + 2 * q[2] * x * z +
+             2 * q[3] * x + q[4] * y * y + 2 * q[5] * y * z +
+             2 * q[6] * y + q[7] * z * z + 2 * q[8] * z + q[9];
+    }
+
+    // position minimizing the error, false if the system is singular
+    bool optimum(double p[3]) const
+    {
+      double a = q[0], b = q[1], c = q[2];
+      double e = q[4], f = q[5], i = q[7];
+      double det = a * (e * i - f * f) - b * (b * i - f * c) +
+                   c * (b * f - e * c);
+
+      if (std::abs(det) < 1e-12)
+        return false;
+
+      double r0 = -q[3], r1 = -q[6], r2 = -q[8];
+      p[0] = (r0 * (e * i - f * f) - b * (r1 * i - f * r2) +
+              c * (r1 * f - e * r2)) / det;
+      p[1] = (a * (r1 * i - f * r2) - r0 * (b * i - f * c) +
+              c * (b * r2 - r1 * c)) / det;
+      p[2] = (a * (e * r2 - r1 * f) - b * (b * r2 - r1 * c) +
+              r0 * (b * f - e * c)) / det;
+      return true;
+    }
+  };
+
+  struct Candidate
+  {
+    double cost;
+    uint32_t a, b;
+    uint32_t versionA, versionB;
+    double position[3];
+
+    bool operator<(const Candidate& other) const
+    {
+      return cost > other.cost;
+    }
+  };
+
+  // working state of the simplifier
+  std::vector<double> position;
+  std::vector<Quadric> quadric;
+  std::vector<uint32_t> version;
+  std::vector<bool> removed;
+  std::vector<uint32_t> triangles;
+  std::vector<bool> alive;
+  std::vector<std::vector<uint32_t>> vertexTriangles;
+  std::priority_queue<Candidate> heap;
+
+  // bounding sphere of the original mesh
+  point_t center;
+  T radius = 0;
+
+  static void normalOf(const double *a, const double *b, const double *c,
+                       double n[3])
+  {
+    double u[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+    double v[3] = { c[0] - a[0], c[1] - a[1], c[2] - a[2] };
+    n[0] = u[1] * v[2] - u[2] * v[1];
+    n[1] = u[2] * v[0] - u[0] * v[2];
+    n[2] = u[0] * v[1] - u[1] * v[0];
+  }
+
+  void pushCandidate(uint32_t a, uint32_t b)
+  {
+    Candidate candidate;
+    candidate.a = a;
+    candidate.b = b;
+    candidate.versionA = version[a];
+    candidate.versionB = version[b];
+
+    Quadric q = quadric[a];
+    q += quadric[b];
+
+    if (!q.optimum(candidate.position))
+    {
+      // fall back to the best of the endpoints and the midpoint
+      const double *pa = &position[3 * a];
+      const double *pb = &position[3 * b];
+      double mid[3] =
+      {
+        (pa[0] + pb[0]) / 2, (pa[1] + pb[1]) / 2, (pa[2] + pb[2]) / 2
+      };
+      const double *options[] = { pa, pb, mid };
+      double best = -1;
+
+      for (auto option : options)
+      {
+        double cost = q.evaluate(option);
+
+        if (best < 0 || cost < best)
+        {
+          best = cost;
+          std::copy(option, option + 3, candidate.position);
+        }
+      }
+    }
+
+    candidate.cost = std::max(0.0, q.evaluate(candidate.position));
+    heap.push(candidate);
+  }
+
+  // true if moving a and b to p flips any of their remaining triangles
+  bool flips(uint32_t a, uint32_t b, const double p[3]) const
+  {
+    for (auto v : { a, b })
+    {
+      for (auto t : vertexTriangles[v])
+      {
+        if (!alive[t])
+          continue;
+
+        const uint32_t *tri = &triangles[3 * t];
+
+        if ((tri[0] == a || tri[1] == a || tri[2] == a) &&
+            (tri[0] == b || tri[1] == b || tri[2] == b))
+          continue;
+
+        const double *corners[3];
+        const double *moved[3];
+
+        for (int k = 0; k < 3; ++k)
+        {
+          corners[k] = &position[3 * tri[k]];
+          moved[k] = (tri[k] == a || tri[k] == b) ? p : corners[k];
+        }
+
+        double before[3], after[3];
+        normalOf(corners[0], corners[1], corners[2], before);
+        normalOf(moved[0], moved[1], moved[2], after);
+
+        if (before[0] * after[0] + before[1] * after[1] +
+            before[2] * after[2] <= 0)
+          return true;
+      }
+    }
+
+    return false;
+  }
+
+  // compact the surviving triangles into a new level
+  void snapshot(double error)
+  {
+    std::vector<int64_t> remap(removed.size(), -1);
+    std::vector<point_t> vertices;
+    std::vector<size_t> indices;
+
+    for (size_t t = 0; t < alive.size(); ++t)
+    {
+      if (!alive[t])
+        continue;
+
+      for (int k = 0; k < 3; ++k)
+      {
+        uint32_t v = triangles[3 * t + k];
+
+        if (remap[v] < 0)
+        {
+          remap[v] = static_cast<int64_t>(vertices.size());
+          vertices.emplace_back(static_cast<T>(position[3 * v]),
+                                static_cast<T>(position[3 * v + 1]),
+                                static_cast<T>(position[3 * v + 2]));
+        }
+
+        indices.push_back(static_cast<size_t>(remap[v]));
+      }
+    }
+
+    std::vector<size_t> sizes(indices.size() / 3, 3);
+    auto level = std::make_shared<Model<T>>(levels.front()->label);
+
+    if (level->assign(vertices, indices, sizes))
+    {
+      levels.push_back(level);
+      errors.push_back(static_cast<T>(std::sqrt(error)));
+    }
+  }
+
+  void simplify(size_t levelCount, double ratio, size_t minTriangles)
+  {
+    const Mesh<T>& mesh = *levels.front();
+
+    // number vertices and triangulate faces as fans
+    std::unordered_map<const point_t *, uint32_t> index;
+
+    for (const auto& row : mesh.points)
+    {
+      for (const auto& vertex : row)
+      {
+        index[&vertex] = static_cast<uint32_t>(position.size() / 3);
+        position.push_back(vertex.x());
+        position.push_back(vertex.y());
+        position.push_back(vertex.z());
+      }
+    }
+
+    size_t vertexCount = position.size() / 3;
+
+    if (vertexCount == 0)
+      return;
+
+    double lower[3] = { position[0], position[1], position[2] };
+    double upper[3] = { position[0], position[1], position[2] };
+
+    for (size_t i = 0; i < position.size(); ++i)
+    {
+      lower[i % 3] = std::min(lower[i % 3], position[i]);
+      upper[i % 3] = std::max(upper[i % 3], position[i]);
+    }
+
+    double mid[3] =
+    {
+      (lower[0] + upper[0]) / 2, (lower[1] + upper[1]) / 2,
+      (lower[2] + upper[2]) / 2
+    };
+    double radius2 = 0;
+
+    for (size_t i = 0; i < vertexCount; ++i)
+    {
+      const double *p = &position[3 * i];
+      radius2 = std::max(radius2, (p[0] - mid[0]) * (p[0] - mid[0]) +
+                         (p[1] - mid[1]) * (p[1] - mid[1]) +
+                         (p[2] - mid[2]) * (p[2] - mid[2]));
+    }
+
+    center = point_t(static_cast<T>(mid[0]), static_cast<T>(mid[1]),
+                     static_cast<T>(mid[2]), 1);
+    radius = static_cast<T>(std::sqrt(radius2));
+
+    for (const auto& face : mesh.faces)
+    {
+      for (size_t k = 1; k + 1 < face.vertices.size(); ++k)
+      {
+        triangles.push_back(index[face.vertices[0]]);
+        triangles.push_back(index[face.vertices[k]]);
+        triangles.push_back(index[face.vertices[k + 1]]);
+      }
+    }
+
+    size_t triangleCount = triangles.size() / 3;
+    quadric.assign(vertexCount, Quadric());
+    version.assign(vertexCount, 0);
+    removed.assign(vertexCount, false);
+    alive.assign(triangleCount, true);
+    vertexTriangles.assign(vertexCount, std::vector<uint32_t>());
+
+    // plane quadrics of the triangles ----------------------------------------
+    std::vector<std::pair<uint64_t, uint32_t>> edges;
+
+    for (uint32_t t = 0; t < triangleCount; ++t)
+    {
+      const uint32_t *tri = &triangles[3 * t];
+      double n[3];
+      normalOf(&position[3 * tri[0]], &position[3 * tri[1]],
+               &position[3 * tri[2]], n);
+      double length = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+
+      for (int k = 0; k < 3; ++k)
+      {
+        vertexTriangles[tri[k]].push_back(t);
+
+        uint32_t a = std::min(tri[k], tri[(k + 1) % 3]);
+        uint32_t b = std::max(tri[k], tri[(k + 1) % 3]);
+        edges.emplace_back((static_cast<uint64_t>(a) << 32) | b, t);
+      }
+
+      if (length == 0)
+        continue;
+
+      for (auto& c : n)
+        c /= length;
+
+      const double *p = &position[3 * tri[0]];
+      double d = -(n[0] * p[0] + n[1] * p[1] + n[2] * p[2]);
+
+      for (int k = 0; k < 3; ++k)
+        quadric[tri[k]].addPlane(n[0], n[1], n[2], d);
+    }
+
+    // keep open borders in place with heavy perpendicular planes ------------
+    std::sort(edges.begin(), edges.end());
+
+    for (size_t i = 0; i < edges.size();)
+    {
+      size_t j = i;
+
+      while (j < edges.size() && edges[j].first == edges[i].first)
+        ++j;
+
+      uint32_t a = static_cast<uint32_t>(edges[i].first >> 32);
+      uint32_t b = static_cast<uint32_t>(edges[i].first & 0xffffffff);
+
+      if (j - i == 1)
+      {
+        const uint32_t *tri = &triangles[3 * edges[i].second];
+        double n[3];
+        normalOf(&position[3 * tri[0]], &position[3 * tri[1]],
+                 &position[3 * tri[2]], n);
+
+        const double *pa = &position[3 * a];
+        const double *pb = &position[3 * b];
+        double e[3] = { pb[0] - pa[0], pb[1] - pa[1], pb[2] - pa[2] };
+        double m[3] =
+        {
+          e[1] * n[2] - e[2] * n[1],
+          e[2] * n[0] - e[0] * n[2],
+          e[0] * n[1] - e[1] * n[0]
+        };
+        double length = std::sqrt(m[0] * m[0] + m[1] * m[1] + m[2] * m[2]);
+
+        if (length > 0)
+        {
+          for (auto& c : m)
+            c /= length;
+
+          double d = -(m[0] * pa[0] + m[1] * pa[1] + m[2] * pa[2]);
+          quadric[a].addPlane(m[0], m[1], m[2], d, 1000);
+          quadric[b].addPlane(m[0], m[1], m[2], d, 1000);
+        }
+      }
+
+      pushCandidate(a, b);
+      i = j;
+    }
+
+    // collapse cheapest edges, taking a snapshot at every level target -----
+    size_t aliveCount = triangleCount;
+    size_t target = static_cast<size_t>(triangleCount * ratio);
+    double maxError = 0;
+
+    while (levels.size() < levelCount && target >= minTriangles &&
+           !heap.empty())
+    {
+      Candidate c = heap.top();
+      heap.pop();
+
+      if (removed[c.a] || removed[c.b] || version[c.a] != c.versionA ||
+          version[c.b] != c.versionB || flips(c.a, c.b, c.position))
+        continue;
+
+      // move b into a
+      std::copy(c.position, c.position + 3, &position[3 * c.a]);
+      quadric[c.a] += quadric[c.b];
+      removed[c.b] = true;
+      maxError = std::max(maxError, c.cost);
+
+      for (auto t : vertexTriangles[c.b])
+      {
+        if (!alive[t])
+          continue;
+
+        uint32_t *tri = &triangles[3 * t];
+
+        if (tri[0] == c.a || tri[1] == c.a || tri[2] == c.a)
+        {
+          alive[t] = false;
+          aliveCount--;
+          continue;
+        }
+
+        for (int k = 0; k < 3; ++k)
+          if (tri[k] == c.b)
+            tri[k] = c.a;
+
+        vertexTriangles[c.a].push_back(t);
+      }
+
+      vertexTriangles[c.b].clear();
+
+      auto& around = vertexTriangles[c.a];
+      around.erase(std::remove_if(around.begin(), around.end(),
+                                  [this](uint32_t t)
+      {
+        return !alive[t];
+      }), around.end());
+
+      // edges of a changed cost
+      version[c.a]++;
+      std::vector<uint32_t> neighbours;
+
+      for (auto t : around)
+        for (int k = 0; k < 3; ++k)
+          if (triangles[3 * t + k] != c.a)
+            neighbours.push_back(triangles[3 * t + k]);
+
+      std::sort(neighbours.begin(), neighbours.end());
+      neighbours.erase(std::unique(neighbours.begin(), neighbours.end()),
+                       neighbours.end());
+
+      for (auto n : neighbours)
+        pushCandidate(c.a, n);
+
+      if (aliveCount <= target)
+      {
+        this->snapshot(maxError);
+        target = static_cast<size_t>(target * ratio);
+      }
+    }
+
+    // release working state
+    std::vector<double>().swap(position);
+    std::vector<Quadric>().swap(quadric);
+    std::vector<uint32_t>().swap(version);
+    std::vector<bool>().swap(removed);
+    std::vector<uint32_t>().swap(triangles);
+    std::vector<bool>().swap(alive);
+    std::vector<std::vector<uint32_t>>().swap(vertexTriangles);
+    std::priority_queue<Candidate>().swap(heap);
+  }
+
+public:
+  /// levels[0] is the original mesh.
+  std::vector<std::shared_ptr<Mesh<T>>> levels;
+
+  /// Geometric error of each level in object units (0 for level 0).
+  std::vector<T> errors;
+
+  /// Allowed screen space error in pixels when selecting a level.
+  T pixelTolerance = 1.0f;
+
+  MeshLOD(std::shared_ptr<Mesh<T>> mesh, size_t levelCount = 5,
+          double ratio = 0.5, size_t minTriangles = 16)
+  {
+    levels.push_back(mesh);
+    errors.push_back(0);
+    this->simplify(levelCount, ratio, minTriangles);
+  }
+
+  virtual ~MeshLOD()
+  {}
+
+  /// Pick the coarsest level whose error, projected with the given
+  /// rotation, central projection and window to viewport transform, stays
+  /// within pixelTolerance. The error is measured at the point of the
+  /// bounding sphere closest to the viewer, where it appears largest.
+  size_t selectLevel(const Matrix<T>& rot, const Matrix<T>& cp,
+                     const Matrix<T>& wtv) const
+  {
+    point_t nearest = center.transformed(rot);
+    nearest.setZ(nearest.z() + radius);
+    T w = nearest.transformed(cp).w();
+
+    if (w <= 0)
+      return 0;
+
+    T pixelsPerUnit = std::max(std::abs(wtv(0, 0)), std::abs(wtv(1, 1))) / w;
+
+    for (size_t i = levels.size() - 1; i > 0; --i)
+      if (errors[i] * pixelsPerUnit <= pixelTolerance)
+        return i;
+
+    return 0;
+  }
+
+  /// Returns the level picked by selectLevel().
+  inline Mesh<T>& select(const Matrix<T>& rot, const Matrix<T>& cp,
+                         const Matrix<T>& wtv) const
+  {
+    return *levels[this->selectLevel(rot, cp, wtv)];
+  }
+
+  /// Copy display settings of the original mesh to every level.
+  void syncSettings()
+  {
+    const Mesh<T>& base = *levels.front();
+
+    for (size_t i = 1; i < levels.size(); ++i)
+    {
+      Mesh<T>& level = *levels[i];
+      level.lineWidth = base.lineWidth;
+      level.pointSize = base.pointSize;
+      level.pointColor = base.pointColor;
+      level.edgeColor = base.edgeColor;
+      level.normalColor = base.normalColor;
+      level.color = base.color;
+      level.filled = base.filled;
+      level.drawEdges = base.drawEdges;
+      level.drawNormals = base.drawNormals;
+      level.drawPoints = base.drawPoints;
+      level.backfaceCull = base.backfaceCull;
+      level.smooth = base.smooth;
+      level.clipper = base.clipper;
+    }
+  }
+
+}; // end class MeshLOD
+
+} // end namespace Utils
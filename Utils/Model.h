@@ -0,0 +1,831 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cctype>
+#include <cstring>
+#include <limits>
+#include <string>
+#include <vector>
+#include "Mesh.h"
+#include "MappedFile.h"
+#include "MeshCache.h"
+
+namespace Utils
+{
+
+// ----------------------------------------------------------------------------
+// Mesh loaded from a Wavefront OBJ or a binary PLY file
+// ----------------------------------------------------------------------------
+template <typename T>
+class Model : public Mesh<T>
+{
+private:
+  typedef typename Mesh<T>::point_t point_t;
+  typedef typename Mesh<T>::point3D_t point3D_t;
+  typedef typename Mesh<T>::point2D_t point2D_t;
+  typedef typename Mesh<T>::vector3D_t vector3D_t;
+
+  typedef typename Mesh<T>::Face Face;
+
+  // face corners as indices into points[0], faceSizes[i] corners per face
+  std::vector<size_t> faceIndices;
+  std::vector<size_t> faceSizes;
+
+  size_t loadedBytes = 0;
+  double loadSeconds = 0.0;
+
+  // loaded geometry does not depend on segments
+  virtual void recalcPoints()
+  {}
+
+  // PLY scalar types
+  enum PlyType
+  {
+    PLY_INVALID, PLY_INT8, PLY_UINT8, PLY_INT16, PLY_UINT16,
+    PLY_INT32, PLY_UINT32, PLY_FLOAT32, PLY_FLOAT64
+  };
+
+  struct PlyProperty
+  {
+    std::string name;
+    PlyType type = PLY_INVALID;
+    PlyType countType = PLY_INVALID;
+    bool isList = false;
+  };
+
+  struct PlyElement
+  {
+    std::string name;
+    size_t count = 0;
+    std::vector<PlyProperty> properties;
+  };
+
+  // tokenizer ----------------------------------------------------------------
+  static inline bool isBlank(char c)
+  {
+    return c == ' ' || c == '\t' || c == '\r';
+  }
+
+  static inline void skipBlanks(const char *& p, const char *end)
+  {
+    while (p < end && isBlank(*p))
+      ++p;
+  }
+
+  static inline void skipLine(const char *& p, const char *end)
+  {
+    while (p < end && *p != '\n')
+      ++p;
+
+    if (p < end)
+      ++p;
+  }
+
+  static inline void skipToken(const char *& p, const char *end)
+  {
+    while (p < end && !isBlank(*p) && *p != '\n')
+      ++p;
+  }
+
+  static bool parseInt(const char *& p, const char *end, long& value)
+  {
+    bool negative = false;
+
+    if (p < end && (*p == '-' || *p == '+'))
+      negative = *p++ == '-';
+
+    if (p == end || *p < '0' || *p > '9')
+      return false;
+
+    long result = 0;
+
+    while (p < end && *p >= '0' && *p <= '9')
+    {
+      long digit = *p++ - '0';
+
+      if (result > (std::numeric_limits<long>::max() - digit) / 10)
+        return false;
+
+      result = result * 10 + digit;
+    }
+
+    value = negative ? -result : result;
+    return true;
+  }
+
+  static bool parseReal(const char *& p, const char *end, T& value)
+  {
+    bool negative = false;
+
+    if (p < end && (*p == '-' || *p == '+'))
+      negative = *p++ == '-';
+
+    double mantissa = 0.0;
+    bool digits = false;
+
+    while (p < end && *p >= '0' && *p <= '9')
+    {
+      mantissa = mantissa * 10 + (*p++ - '0');
+      digits = true;
+    }
+
+    int exponent = 0;
+
+    if (p < end && *p == '.')
+    {
+      ++p;
+
+      while (p < end && *p >= '0' && *p <= '9')
+      {
+        mantissa = mantissa * 10 + (*p++ - '0');
+        --exponent;
+        digits = true;
+      }
+    }
+
+    if (!digits)
+      return false;
+
+    if (p < end && (*p == 'e' || *p == 'E'))
+    {
+      ++p;
+      long e = 0;
+
+      if (!parseInt(p, end, e))
+        return false;
+
+      exponent += static_cast<int>(e);
+    }
+
+    if (exponent)
+      mantissa *= std::pow(10.0, exponent);
+
+    value = static_cast<T>(negative ? -mantissa : mantissa);
+    return true;
+  }
+
+  // PLY helpers --------------------------------------------------------------
+  static PlyType plyType(const std::string& name)
+  {
+    if (name == "char" || name == "int8")
+      return PLY_INT8;
+
+    if (name == "uchar" || name == "uint8")
+      return PLY_UINT8;
+
+    if (name == "short" || name == "int16")
+      return PLY_INT16;
+
+    if (name == "ushort" || name == "uint16")
+      return PLY_UINT16;
+
+    if (name == "int" || name == "int32")
+      return PLY_INT32;
+
+    if (name == "uint" || name == "uint32")
+      return PLY_UINT32;
+
+    if (name == "float" || name == "float32")
+      return PLY_FLOAT32;
+
+    if (name == "double" || name == "float64")
+      return PLY_FLOAT64;
+
+    return PLY_INVALID;
+  }
+
+  static size_t plySize(PlyType type)
+  {
+    static const size_t sizes[] = { 0, 1, 1, 2, 2, 4, 4, 4, 8 };
+    return sizes[type];
+  }
+
+  /// Convert a PLY list count or index, false unless it is a finite,
+  /// non-negative number that fits into a size_t.
+  static bool plyIndex(double value, size_t& index)
+  {
+    static const double limit =
+      std::ldexp(1.0, std::numeric_limits<size_t>::digits);
+
+    if (!std::isfinite(value) || value < 0 || value >= limit)
+      return false;
+
+    index = static_cast<size_t>(value);
+    return true;
+  }
+
+  static double readPly(const char *& p, PlyType type, bool swap)
+  {
+    unsigned char raw[8];
+    size_t size = plySize(type);
+    std::memcpy(raw, p, size);
+    p += size;
+
+    if (swap)
+      for (size_t i = 0; i < size / 2; ++i)
+        std::swap(raw[i], raw[size - 1 - i]);
+
+    switch (type)
+    {
+    case PLY_INT8:
+    {
+      int8_t v;
+      std::memcpy(&v, raw, 1);
+      return v;
+    }
+
+    case PLY_UINT8:
+      return raw[0];
+
+    case PLY_INT16:
+    {
+      int16_t v;
+      std::memcpy(&v, raw, 2);
+      return v;
+    }
+
+    case PLY_UINT16:
+    {
+      uint16_t v;
+      std::memcpy(&v, raw, 2);
+      return v;
+    }
+
+    case PLY_INT32:
+    {
+      int32_t v;
+      std::memcpy(&v, raw, 4);
+      return v;
+    }
+
+    case PLY_UINT32:
+    {
+      uint32_t v;
+      std::memcpy(&v, raw, 4);
+      return v;
+    }
+
+    case PLY_FLOAT32:
+    {
+      float v;
+      std::memcpy(&v, raw, 4);
+      return v;
+    }
+
+    case PLY_FLOAT64:
+    {
+      double v;
+      std::memcpy(&v, raw, 8);
+      return v;
+    }
+
+    default:
+      return 0;
+    }
+  }
+
+  static std::string nextWord(const char *& p, const char *end)
+  {
+    skipBlanks(p, end);
+    const char *start = p;
+    skipToken(p, end);
+    return std::string(start, p);
+  }
+
+  // Faces hold pointers into points[0], so they are created only after the
+  // vertex array has reached its final size.
+  bool buildFaces()
+  {
+    auto& vertices = this->points.front();
+    this->faces.clear();
+    this->faces.reserve(faceSizes.size());
+
+    size_t corner = 0;
+
+    for (auto size : faceSizes)
+    {
+      Face face;
+      face.vertices.reserve(size);
+
+      for (size_t i = 0; i < size; ++i, ++corner)
+      {
+        if (corner >= faceIndices.size() ||
+            faceIndices[corner] >= vertices.size())
+          return false;
+
+        face.vertices.emplace_back(&vertices[faceIndices[corner]]);
+      }
+
+      this->prepareFace(face);
+      this->faces.emplace_back(std::move(face));
+    }
+
+    faceIndices.clear();
+    faceIndices.shrink_to_fit();
+    faceSizes.clear();
+    faceSizes.shrink_to_fit();
+    return true;
+  }
+
+  void reset()
+  {
+    this->points.assign(1, std::vector<point_t>());
+    this->faces.clear();
+    this->invalidateConnectivity();
+    faceIndices.clear();
+    faceSizes.clear();
+    loadedBytes = 0;
+    loadSeconds = 0.0;
+  }
+
+  bool parseOBJ(const char *p, const char *end)
+  {
+    auto& vertices = this->points.front();
+
+    // rough guess from typical line lengths, saves most regrowth
+    vertices.reserve((end - p) / 64);
+    faceIndices.reserve((end - p) / 16);
+    faceSizes.reserve((end - p) / 64);
+
+    while (p < end)
+    {
+      skipBlanks(p, end);
+
+      if (p + 1 < end && p[0] == 'v' && isBlank(p[1]))
+      {
+        p += 2;
+        T xyz[3];
+
+        for (auto& coord : xyz)
+        {
+          skipBlanks(p, end);
+
+          if (!parseReal(p, end, coord))
+            return false;
+        }
+
+        vertices.emplace_back(xyz[0], xyz[1], xyz[2]);
+      }
+      else if (p + 1 < end && p[0] == 'f' && isBlank(p[1]))
+      {
+        p += 2;
+        size_t corners = 0;
+
+        for (;;)
+        {
+          skipBlanks(p, end);
+
+          if (p == end || *p == '\n' || *p == '#')
+            break;
+
+          long index;
+
+          if (!parseInt(p, end, index) || index == 0)
+            return false;
+
+          // negative indices count back from the last vertex read so far
+          if (index < 0)
+            index += static_cast<long>(vertices.size());
+          else
+            --index;
+
+          if (index < 0)
+            return false;
+
+          faceIndices.push_back(static_cast<size_t>(index));
+          ++corners;
+
+          // ignore texture and normal indices (v/vt/vn)
+          skipToken(p, end);
+        }
+
+        if (corners >= 3)
+          faceSizes.push_back(corners);
+        else
+          faceIndices.resize(faceIndices.size() - corners);
+      }
+
+      skipLine(p, end);
+    }
+
+    return true;
+  }
+
+  bool parsePLY(const char *p, const char *end)
+  {
+    // header -----------------------------------------------------------------
+    if (nextWord(p, end) != "ply")
+      return false;
+
+    skipLine(p, end);
+
+    bool swap = false;
+    std::vector<PlyElement> elements;
+
+    uint16_t probe = 1;
+    bool hostLittle = *reinterpret_cast<unsigned char *>(&probe) == 1;
+
+    for (;;)
+    {
+      if (p >= end)
+        return false;
+
+      auto keyword = nextWord(p, end);
+
+      if (keyword == "format")
+      {
+        auto format = nextWord(p, end);
+
+        if (format == "binary_little_endian")
+          swap = !hostLittle;
+        else if (format == "binary_big_endian")
+          swap = hostLittle;
+        else
+          return false;
+      }
+      else if (keyword == "element")
+      {
+        elements.emplace_back();
+        elements.back().name = nextWord(p, end);
+        skipBlanks(p, end);
+        long count;
+
+        if (!parseInt(p, end, count) || count < 0)
+          return false;
+
+        elements.back().count = static_cast<size_t>(count);
+      }
+      else if (keyword == "property")
+      {
+        if (elements.empty())
+          return false;
+
+        PlyProperty property;
+        auto type = nextWord(p, end);
+
+        if (type == "list")
+        {
+          property.isList = true;
+          property.countType = plyType(nextWord(p, end));
+          type = nextWord(p, end);
+
+          if (property.countType == PLY_INVALID)
+            return false;
+        }
+
+        property.type = plyType(type);
+        property.name = nextWord(p, end);
+
+        if (property.type == PLY_INVALID)
+          return false;
+
+        elements.back().properties.push_back(property);
+      }
+      else if (keyword == "end_header")
+      {
+        skipLine(p, end);
+        break;
+      }
+
+      skipLine(p, end);
+    }
+
+    // body -------------------------------------------------------------------
+    auto& vertices = this->points.front();
+
+    for (const auto& element : elements)
+    {
+      bool isVertex = element.name == "vertex";
+      bool isFace = element.name == "face";
+
+      // such an element reads no input, its count alone could loop forever
+      if (element.count && element.properties.empty())
+        return false;
+
+      // a bogus count in the header must not reserve more than the body
+      // can hold
+      const size_t expected =
+        std::min(element.count, static_cast<size_t>(end - p));
+
+      if (isVertex)
+        vertices.reserve(expected);
+
+      if (isFace)
+      {
+        faceSizes.reserve(expected);
+        faceIndices.reserve(expected * 3);
+      }
+
+      for (size_t i = 0; i < element.count; ++i)
+      {
+        double xyz[3] = { 0, 0, 0 };
+
+        for (const auto& property : element.properties)
+        {
+          if (property.isList)
+          {
+            if (p + plySize(property.countType) > end)
+              return false;
+
+            size_t count;
+            const size_t size = plySize(property.type);
+
+            // compared by division, a huge count must not wrap the pointer
+            if (!plyIndex(readPly(p, property.countType, swap), count) ||
+                !size || count > static_cast<size_t>(end - p) / size)
+              return false;
+
+            bool indices = isFace && (property.name == "vertex_indices" ||
+                                      property.name == "vertex_index");
+
+            if (!indices)
+            {
+              p += count * size;
+              continue;
+            }
+
+            for (size_t j = 0; j < count; ++j)
+            {
+              size_t index;
+
+              if (!plyIndex(readPly(p, property.type, swap), index))
+                return false;
+
+              faceIndices.push_back(index);
+            }
+
+            if (count >= 3)
+              faceSizes.push_back(count);
+            else
+              faceIndices.resize(faceIndices.size() - count);
+          }
+          else
+          {
+            if (p + plySize(property.type) > end)
+              return false;
+
+            double value = readPly(p, property.type, swap);
+
+            if (isVertex && property.name.size() == 1 &&
+                property.name[0] >= 'x' && property.name[0] <= 'z')
+              xyz[property.name[0] - 'x'] = value;
+          }
+        }
+
+        if (isVertex)
+          vertices.emplace_back(static_cast<T>(xyz[0]),
+                                static_cast<T>(xyz[1]),
+                                static_cast<T>(xyz[2]));
+      }
+    }
+
+    return true;
+  }
+
+  template <typename Parser>
+  bool loadWith(const std::string& path, Parser parser)
+  {
+    auto start = std::chrono::steady_clock::now();
+    this->reset();
+
+    MappedFile file(path);
+
+    if (!file.isOpen())
+      return false;
+
+    if (!(this->*parser)(file.begin(), file.end()) || !this->buildFaces())
+    {
+      this->reset();
+      return false;
+    }
+
+    std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+
+    loadedBytes = file.size();
+    loadSeconds = elapsed.count();
+    return true;
+  }
+
+public:
+
+  // empty model, call load() to fill it
+  Model(std::string label = "Model")
+    : Mesh<T>(0, label)
+  {
+    this->points.emplace_back();
+  }
+
+  virtual ~Model()
+  {}
+
+  /// Load an OBJ, binary PLY or mesh cache file, chosen by extension.
+  bool load(const std::string& path)
+  {
+    auto dot = path.find_last_of('.');
+    std::string ext = dot == std::string::npos ? "" : path.substr(dot + 1);
+
+    for (auto& c : ext)
+      c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+
+    if (ext == "ply")
+      return this->loadPLY(path);
+
+    if (ext == "bgmc")
+      return this->loadCache(path);
+
+    return this->loadOBJ(path);
+  }
+
+  /// Load a Wavefront OBJ file. Only vertex positions and faces are used.
+  bool loadOBJ(const std::string& path)
+  {
+    return this->loadWith(path, &Model<T>::parseOBJ);
+  }
+
+  /// Load a binary (little or big endian) PLY file.
+  bool loadPLY(const std::string& path)
+  {
+    return this->loadWith(path, &Model<T>::parsePLY);
+  }
+
+  /// Replace the geometry. Face i uses sizes[i] consecutive entries of
+  /// indices, which refer to vertices.
+  bool assign(const std::vector<point_t>& vertices,
+              const std::vector<size_t>& indices,
+              const std::vector<size_t>& sizes)
+  {
+    this->reset();
+    this->points.front() = vertices;
+    faceIndices = indices;
+    faceSizes = sizes;
+
+    if (!this->buildFaces())
+    {
+      this->reset();
+      return false;
+    }
+
+    return true;
+  }
+
+  /// Load a mesh cache written by writeMeshCache(). Normals and centroids
+  /// are taken from the file instead of being recalculated. With a
+  /// sourcePath, a cache written from another version of that file is
+  /// rejected as stale.
+  bool loadCache(const std::string& path,
+                 const std::string& sourcePath = std::string())
+  {
+    auto start = std::chrono::steady_clock::now();
+    this->reset();
+
+    MeshCache cache;
+
+    if (!cache.open(path))
+      return false;
+
+    if (!sourcePath.empty() && !cache.matchesSource(sourcePath))
+      return false;
+
+    auto& vertices = this->points.front();
+    vertices.reserve(cache.getVertexCount());
+
+    const double *xyz = cache.vertices();
+
+    for (size_t i = 0; i < cache.getVertexCount(); ++i, xyz += 3)
+      vertices.emplace_back(static_cast<T>(xyz[0]),
+                            static_cast<T>(xyz[1]),
+                            static_cast<T>(xyz[2]));
+
+    const uint32_t *faceStarts = cache.faceStarts();
+    const uint32_t *indices = cache.indices();
+    const double *normals = cache.normals();
+    const double *centroids = cache.centroids();
+
+    this->faces.resize(cache.getFaceCount());
+
+    for (size_t i = 0; i < this->faces.size(); ++i)
+    {
+      auto& face = this->faces[i];
+      uint32_t first = faceStarts[i];
+      uint32_t last = faceStarts[i + 1];
+
+      if (first > last || last > cache.getIndexCount())
+      {
+        this->reset();
+        return false;
+      }
+
+      face.vertices.reserve(last - first);
+
+      for (uint32_t j = first; j < last; ++j)
+      {
+        if (indices[j] >= vertices.size())
+        {
+          this->reset();
+          return false;
+        }
+
+        face.vertices.emplace_back(&vertices[indices[j]]);
+      }
+
+      face.normal.set(static_cast<T>(normals[3 * i]),
+                      static_cast<T>(normals[3 * i + 1]),
+                      static_cast<T>(normals[3 * i + 2]));
+      face.centroid = point_t(static_cast<T>(centroids[3 * i]),
+                              static_cast<T>(centroids[3 * i + 1]),
+                              static_cast<T>(centroids[3 * i + 2]));
+    }
+
+    std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+
+    loadedBytes = cache.getFileSize();
+    loadSeconds = elapsed.count();
+    return true;
+  }
+
+  /// Write the model into a mesh cache file, stamped with the file it was
+  /// loaded from if sourcePath is given.
+  bool saveCache(const std::string& path,
+                 const std::string& sourcePath = std::string()) const
+  {
+    return writeMeshCache(*this, path, sourcePath);
+  }
+
+  /// Center the model at the origin and scale it into the unit sphere.
+  void fitToUnitSphere()
+  {
+    auto& vertices = this->points.front();
+
+    if (vertices.empty())
+      return;
+
+    T minX = vertices[0].x(), maxX = minX;
+    T minY = vertices[0].y(), maxY = minY;
+    T minZ = vertices[0].z(), maxZ = minZ;
+
+    for (const auto& v : vertices)
+    {
+      minX = std::min(minX, v.x());
+      maxX = std::max(maxX, v.x());
+      minY = std::min(minY, v.y());
+      maxY = std::max(maxY, v.y());
+      minZ = std::min(minZ, v.z());
+      maxZ = std::max(maxZ, v.z());
+    }
+
+    T cx = (minX + maxX) / 2, cy = (minY + maxY) / 2, cz = (minZ + maxZ) / 2;
+    T radius2 = 0;
+
+    for (const auto& v : vertices)
+    {
+      vector3D_t d(v.x() - cx, v.y() - cy, v.z() - cz);
+      radius2 = std::max(radius2, d.lengthSquared());
+    }
+
+    T scale = radius2 > 0 ? 1 / std::sqrt(radius2) : 1;
+
+    for (auto& v : vertices)
+    {
+      v.setX((v.x() - cx) * scale);
+      v.setY((v.y() - cy) * scale);
+      v.setZ((v.z() - cz) * scale);
+    }
+
+    for (auto& face : this->faces)
+      this->prepareFace(face);
+
+    this->invalidateConnectivity();
+  }
+
+  /// Returns number of vertices.
+  inline size_t getVertexCount() const
+  {
+    return this->points.front().size();
+  }
+
+  /// Returns size of the last loaded file in bytes.
+  inline size_t getLoadedBytes() const
+  {
+    return loadedBytes;
+  }
+
+  /// Returns duration of the last load in seconds.
+  inline double getLoadSeconds() const
+  {
+    return loadSeconds;
+  }
+
+  /// Returns load throughput of the last load in MB/s.
+  inline double getThroughput() const
+  {
+    return loadSeconds > 0 ? loadedBytes / loadSeconds / (1024 * 1024) : 0;
+  }
+
+}; // end class Model
+
+} // end namespace Utils
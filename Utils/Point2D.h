@@ -270,11 +270,11 @@ public:
   /// Draw point with OpenGL calls.
   void draw() const
   {
-    glPointSize(size);
+    renderPointSize(size);
     color.setGLColor();
-    glBegin(GL_POINTS);
+    renderBegin(GL_POINTS);
     glVertex2<T>(*this);
-    glEnd();
+    renderEnd();
   }
 
   inline void transform(const Matrix<T>& m)
@@ -340,42 +340,42 @@ public:
 /// Type specific OpenGL calls.
 template <> void glVertex2<GLshort>(const Point2D<GLshort>& p)
 {
-  glVertex2s(p.x(), p.y());
+  renderVertex(p.x(), p.y());
 }
 
 template <> void glVertex2<GLshort>(GLshort x, GLshort y)
 {
-  glVertex2s(x, y);
+  renderVertex(x, y);
 }
 
 template <> void glVertex2<GLint>(const Point2D<GLint>& p)
 {
-  glVertex2i(p.x(), p.y());
+  renderVertex(p.x(), p.y());
 }
 
 template <> void glVertex2<GLint>(GLint x, GLint y)
 {
-  glVertex2i(x, y);
+  renderVertex(x, y);
 }
 
 template <> void glVertex2<GLfloat>(const Point2D<GLfloat>& p)
 {
-  glVertex2f(p.x(), p.y());
+  renderVertex(p.x(), p.y());
 }
 
 template <> void glVertex2<GLfloat>(GLfloat x, GLfloat y)
 {
-  glVertex2f(x, y);
+  renderVertex(x, y);
 }
 
 template <> void glVertex2<GLdouble>(const Point2D<GLdouble>& p)
 {
-  glVertex2d(p.x(), p.y());
+  renderVertex(p.x(), p.y());
 }
 
 template <> void glVertex2<GLdouble>(GLdouble x, GLdouble y)
 {
-  glVertex2d(x, y);
+  renderVertex(x, y);
 }
 
 } // end namespace Utils
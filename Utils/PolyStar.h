@@ -134,15 +134,15 @@ public:
   /// Draw PolyStar with OpenGL calls.
   void draw() const
   {
-    glLineWidth(lineWidth);
+    renderLineWidth(lineWidth);
     color.setGLColor();
 
     size_t spikes = this->getSpikes();
 
     if(filled)
-      glBegin(GL_POLYGON);
+      renderBegin(GL_POLYGON);
     else
-      glBegin(GL_LINE_LOOP);
+      renderBegin(GL_LINE_LOOP);
 
     for(size_t i = 0; i < spikes; i++)
     {
@@ -150,18 +150,18 @@ public:
       glVertex2<T>(inner.pointsContainer[i]);
     }
 
-    glEnd();
+    renderEnd();
   }
 
   /// Draw PolyStar's polygon points.
   void drawPoints() const
   {
-    glPointSize(pointSize);
+    renderPointSize(pointSize);
     pointColor.setGLColor();
 
     size_t spikes = this->getSpikes();
 
-    glBegin(GL_POINTS);
+    renderBegin(GL_POINTS);
 
     for(size_t i = 0; i < spikes; i++)
     {
@@ -169,7 +169,7 @@ public:
       glVertex2<T>(inner.pointsContainer[i]);
     }
 
-    glEnd();
+    renderEnd();
   }
 
   Polygon2D<T> toPolygon2D() const
@@ -4,6 +4,7 @@
 #include "Point2D.h"
 #include "Line.h"
 #include "Color.h"
+#include "Triangulate.h"
 
 namespace Utils
 {
@@ -14,6 +15,35 @@ class Polygon2D
 protected:
   size_t points = 0;
 
+private:
+  // triangles of the filled polygon and the points they were built from
+  mutable std::vector<uint32_t> triangles;
+  mutable std::vector<double> triangulatedX;
+  mutable std::vector<double> triangulatedY;
+
+  bool trianglesValid() const
+  {
+    if (triangulatedX.size() != pointsContainer.size())
+      return false;
+
+    for (size_t i = 0; i < pointsContainer.size(); ++i)
+      if (triangulatedX[i] != pointsContainer[i].x() ||
+          triangulatedY[i] != pointsContainer[i].y())
+        return false;
+
+    return true;
+  }
+
+  void drawFilled() const
+  {
+    renderBegin(GL_TRIANGLES);
+
+    for (auto i : getTriangles())
+      glVertex2<T>(pointsContainer[i]);
+
+    renderEnd();
+  }
+
 public:
   std::vector <Point2D<T>> pointsContainer;
   GLfloat lineWidth = 1.0;
@@ -44,6 +74,34 @@ public:
     return this->points;
   }
 
+  /// Replace all points, keeping color and sizes.
+  inline void setPoints(const std::vector<Point2D<T>>& newPoints)
+  {
+    this->pointsContainer = newPoints;
+    this->points = newPoints.size();
+  }
+
+  /// Triangles of the polygon as index triples into pointsContainer. They
+  /// are computed again only after a point has moved.
+  const std::vector<uint32_t>& getTriangles() const
+  {
+    if (!trianglesValid())
+    {
+      triangulatedX.clear();
+      triangulatedY.clear();
+
+      for (const auto& point : pointsContainer)
+      {
+        triangulatedX.push_back(static_cast<double>(point.x()));
+        triangulatedY.push_back(static_cast<double>(point.y()));
+      }
+
+      triangles = triangulate(triangulatedX, triangulatedY);
+    }
+
+    return triangles;
+  }
+
   inline Point2D<T> *checkClick(GLint xMouse, GLint yMouse, int sens)
   {
     Point2D<T> *active = nullptr;
@@ -174,53 +232,59 @@ public:
 
   void draw() const
   {
-    glLineWidth(lineWidth);
+    renderLineWidth(lineWidth);
     color.setGLColor();
 
     if (filled)
-      glBegin(GL_POLYGON);
-    else
-      glBegin(GL_LINE_LOOP);
+    {
+      drawFilled();
+      return;
+    }
+
+    renderBegin(GL_LINE_LOOP);
 
     for (const auto& point : pointsContainer)
     {
       glVertex2<T>(point);
     }
 
-    glEnd();
+    renderEnd();
   }
 
   void drawWithOtherColor(Color c) const
   {
-    glLineWidth(lineWidth);
+    renderLineWidth(lineWidth);
     c.setGLColor();
 
     if (filled)
-      glBegin(GL_POLYGON);
-    else
-      glBegin(GL_LINE_LOOP);
+    {
+      drawFilled();
+      return;
+    }
+
+    renderBegin(GL_LINE_LOOP);
 
     for (const auto& point : pointsContainer)
     {
       glVertex2<T>(point);
     }
 
-    glEnd();
+    renderEnd();
   }
 
   void drawPoints() const
   {
-    glPointSize(pointSize);
+    renderPointSize(pointSize);
     pointColor.setGLColor();
 
-    glBegin(GL_POINTS);
+    renderBegin(GL_POINTS);
 
     for (const auto& point : pointsContainer)
     {
       glVertex2<T>(point);
     }
 
-    glEnd();
+    renderEnd();
   }
 
 }; // end class Polygon2D
@@ -91,31 +91,31 @@ public:
 
     if (filled)
     {
-      glBegin(GL_POLYGON);
+      renderBegin(GL_POLYGON);
     }
     else
     {
-      glLineWidth(this->lineWidth);
-      glBegin(GL_LINE_LOOP);
+      renderLineWidth(this->lineWidth);
+      renderBegin(GL_LINE_LOOP);
     }
 
     for (const auto& point : this->pointsContainer)
       glVertex2<T>(point);
 
-    glEnd();
+    renderEnd();
   }
 
   void drawPoints() const
   {
     this->pointColor.setGLColor();
-    glPointSize(this->pointSize);
+    renderPointSize(this->pointSize);
 
-    glBegin(GL_POINTS);
+    renderBegin(GL_POINTS);
 
     for (const auto& point : this->pointsContainer)
       glVertex2<T>(point);
 
-    glEnd();
+    renderEnd();
   }
 
 }; // end class Rectangle
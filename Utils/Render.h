@@ -0,0 +1,420 @@
+#pragma once
+
+#include <GL/freeglut.h>
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace Utils
+{
+
+class CommandBuffer;
+
+// ----------------------------------------------------------------------------
+// Buffer the render* functions record into, nullptr draws immediately.
+// ----------------------------------------------------------------------------
+inline CommandBuffer *& recordingBuffer()
+{
+  static CommandBuffer *buffer = nullptr;
+  return buffer;
+}
+
+// ----------------------------------------------------------------------------
+// One recorded glBegin/glEnd pair. Its vertices are
+// [first, first + count) of the buffer's position and color arenas.
+// ----------------------------------------------------------------------------
+struct DrawCommand
+{
+  GLenum mode;
+  GLfloat size;
+  uint32_t first;
+  uint32_t count;
+};
+
+class RenderBackend;
+
+// ----------------------------------------------------------------------------
+// Recorded frame: typed draw commands with all vertex data in two flat
+// arenas, so a frame can be inspected, batched and replayed by any backend.
+// ----------------------------------------------------------------------------
+class CommandBuffer
+{
+private:
+  GLubyte color[4] = { 0, 0, 0, 255 };
+  GLfloat lineWidth = 1.0f;
+  GLfloat pointSize = 1.0f;
+  bool open = false;
+
+  // buffer recording before record() was called
+  CommandBuffer *previous = nullptr;
+
+public:
+  std::vector<DrawCommand> commands;
+
+  /// x, y per vertex.
+  std::vector<GLfloat> positions;
+
+  /// r, g, b, a per vertex.
+  std::vector<GLubyte> colors;
+
+  CommandBuffer() {}
+
+  CommandBuffer(const CommandBuffer&) = delete;
+  CommandBuffer& operator=(const CommandBuffer&) = delete;
+
+  virtual ~CommandBuffer()
+  {
+    this->stop();
+  }
+
+  /// Route render* calls into this buffer. Recording nests, stop() returns
+  /// to the buffer that was recording before.
+  inline void record()
+  {
+    if (recordingBuffer() != this)
+    {
+      previous = recordingBuffer();
+      recordingBuffer() = this;
+    }
+  }
+
+  inline void stop()
+  {
+    if (recordingBuffer() == this)
+      recordingBuffer() = previous;
+
+    previous = nullptr;
+  }
+
+  inline bool isRecording() const
+  {
+    return recordingBuffer() == this;
+  }
+
+  /// Drop all commands, keeping the allocated arenas.
+  void clear()
+  {
+    commands.clear();
+    positions.clear();
+    colors.clear();
+    open = false;
+  }
+
+  inline bool empty() const
+  {
+    return commands.empty();
+  }
+
+  inline size_t vertexCount() const
+  {
+    return positions.size() / 2;
+  }
+
+  /// Memory used by the recorded frame.
+  inline size_t byteSize() const
+  {
+    return commands.size() * sizeof(DrawCommand) +
+           positions.size() * sizeof(GLfloat) + colors.size();
+  }
+
+  void begin(GLenum mode)
+  {
+    commands.push_back(DrawCommand
+    {
+      mode, mode == GL_POINTS ? pointSize : lineWidth,
+      static_cast<uint32_t>(this->vertexCount()), 0
+    });
+    open = true;
+  }
+
+  void end()
+  {
+    if (open && commands.back().count == 0)
+      commands.pop_back();
+
+    open = false;
+  }
+
+  void vertex(GLfloat x, GLfloat y)
+  {
+    if (!open)
+      return;
+
+    positions.push_back(x);
+    positions.push_back(y);
+    colors.insert(colors.end(), color, color + 4);
+    commands.back().count++;
+  }
+
+  /// Append count vertices in the current color and return the index of
+  /// the first. Their positions are left for the caller to fill in.
+  size_t addVertices(size_t count)
+  {
+    size_t first = this->vertexCount();
+
+    if (!open)
+      return first;
+
+    positions.resize(positions.size() + 2 * count);
+    colors.resize(colors.size() + 4 * count);
+
+    for (size_t i = colors.size() - 4 * count; i < colors.size(); i += 4)
+      std::copy(color, color + 4, &colors[i]);
+
+    commands.back().count += static_cast<uint32_t>(count);
+    return first;
+  }
+
+  inline void setColor(GLubyte r, GLubyte g, GLubyte b, GLubyte a = 255)
+  {
+    color[0] = r;
+    color[1] = g;
+    color[2] = b;
+    color[3] = a;
+  }
+
+  inline void setLineWidth(GLfloat width)
+  {
+    lineWidth = width;
+  }
+
+  inline void setPointSize(GLfloat size)
+  {
+    pointSize = size;
+  }
+
+  /// Copy all commands of another buffer to the end of this one.
+  void append(const CommandBuffer& other)
+  {
+    auto offset = static_cast<uint32_t>(this->vertexCount());
+
+    for (auto command : other.commands)
+    {
+      command.first += offset;
+      commands.push_back(command);
+    }
+
+    positions.insert(positions.end(), other.positions.begin(),
+                     other.positions.end());
+    colors.insert(colors.end(), other.colors.begin(), other.colors.end());
+  }
+
+  /// Execute all commands with a backend.
+  inline void replay(RenderBackend& backend) const;
+
+}; // end class CommandBuffer
+
+// ----------------------------------------------------------------------------
+// Immediate mode entry points used by all Utils draw methods. They forward
+// to GL unless a CommandBuffer is recording.
+// ----------------------------------------------------------------------------
+inline void renderBegin(GLenum mode)
+{
+  if (auto buffer = recordingBuffer())
+    buffer->begin(mode);
+  else
+    glBegin(mode);
+}
+
+inline void renderEnd()
+{
+  if (auto buffer = recordingBuffer())
+    buffer->end();
+  else
+    glEnd();
+}
+
+inline void renderVertex(GLdouble x, GLdouble y)
+{
+  if (auto buffer = recordingBuffer())
+    buffer->vertex(static_cast<GLfloat>(x), static_cast<GLfloat>(y));
+  else
+    glVertex2d(x, y);
+}
+
+inline void renderColor4ub(GLubyte r, GLubyte g, GLubyte b, GLubyte a = 255)
+{
+  if (auto buffer = recordingBuffer())
+    buffer->setColor(r, g, b, a);
+  else
+    glColor4ub(r, g, b, a);
+}
+
+inline void renderColor3f(GLfloat r, GLfloat g, GLfloat b)
+{
+  if (auto buffer = recordingBuffer())
+  {
+    auto byte = [](GLfloat c)
+    {
+      return static_cast<GLubyte>(std::min(std::max(c, 0.0f), 1.0f) * 255 +
+                                  0.5f);
+    };
+
+    buffer->setColor(byte(r), byte(g), byte(b));
+  }
+  else
+  {
+    glColor3f(r, g, b);
+  }
+}
+
+/// Current clear color, also known without a GL context.
+inline GLclampf *renderClearColor()
+{
+  static GLclampf color[4] = { 0, 0, 0, 0 };
+  return color;
+}
+
+inline void renderClearColor(GLclampf r, GLclampf g, GLclampf b, GLclampf a)
+{
+  GLclampf *color = renderClearColor();
+  color[0] = r;
+  color[1] = g;
+  color[2] = b;
+  color[3] = a;
+  glClearColor(r, g, b, a);
+}
+
+/// Bitmap text at window position x, y. Text is not recorded.
+inline void renderText(GLint x, GLint y, void *font, const std::string& text)
+{
+  if (recordingBuffer())
+    return;
+
+  glRasterPos2i(x, y);
+  glutBitmapString(font,
+                   reinterpret_cast<const unsigned char *>(text.c_str()));
+}
+
+inline void renderLineWidth(GLfloat width)
+{
+  if (auto buffer = recordingBuffer())
+    buffer->setLineWidth(width);
+  else
+    glLineWidth(width);
+}
+
+inline void renderPointSize(GLfloat size)
+{
+  if (auto buffer = recordingBuffer())
+    buffer->setPointSize(size);
+  else
+    glPointSize(size);
+}
+
+// ----------------------------------------------------------------------------
+// Executes recorded command buffers. GL backends replaying while another
+// buffer records append to that buffer instead, like the render* functions.
+// ----------------------------------------------------------------------------
+class RenderBackend
+{
+public:
+  virtual ~RenderBackend() {}
+
+  virtual void execute(const CommandBuffer& buffer) = 0;
+
+}; // end class RenderBackend
+
+inline void CommandBuffer::replay(RenderBackend& backend) const
+{
+  backend.execute(*this);
+}
+
+// ----------------------------------------------------------------------------
+// Replays with glBegin/glEnd, exactly like drawing immediately.
+// ----------------------------------------------------------------------------
+class GLImmediateBackend : public RenderBackend
+{
+public:
+  virtual void execute(const CommandBuffer& buffer)
+  {
+    if (auto target = recordingBuffer())
+      return target->append(buffer);
+
+    for (const auto& command : buffer.commands)
+    {
+      if (command.mode == GL_POINTS)
+        glPointSize(command.size);
+      else
+        glLineWidth(command.size);
+
+      glBegin(command.mode);
+
+      for (uint32_t i = command.first; i < command.first + command.count; ++i)
+      {
+        glColor4ubv(&buffer.colors[4 * i]);
+        glVertex2fv(&buffer.positions[2 * i]);
+      }
+
+      glEnd();
+    }
+  }
+
+}; // end class GLImmediateBackend
+
+// ----------------------------------------------------------------------------
+// Replays from client side vertex arrays. Consecutive points and line
+// segments of the same size are merged into one draw call.
+// ----------------------------------------------------------------------------
+class GLVertexArrayBackend : public RenderBackend
+{
+private:
+  size_t drawCalls = 0;
+
+public:
+  virtual void execute(const CommandBuffer& buffer)
+  {
+    drawCalls = 0;
+
+    if (auto target = recordingBuffer())
+      return target->append(buffer);
+
+    if (buffer.empty())
+      return;
+
+    glEnableClientState(GL_VERTEX_ARRAY);
+    glEnableClientState(GL_COLOR_ARRAY);
+    glVertexPointer(2, GL_FLOAT, 0, buffer.positions.data());
+    glColorPointer(4, GL_UNSIGNED_BYTE, 0, buffer.colors.data());
+
+    const auto& commands = buffer.commands;
+
+    for (size_t i = 0; i < commands.size();)
+    {
+      const auto& command = commands[i];
+      uint32_t count = command.count;
+      size_t j = i + 1;
+
+      // batch independent primitives
+      if (command.mode == GL_POINTS || command.mode == GL_LINES)
+      {
+        while (j < commands.size() && commands[j].mode == command.mode &&
+               commands[j].size == command.size &&
+               commands[j].first == command.first + count)
+          count += commands[j++].count;
+      }
+
+      if (command.mode == GL_POINTS)
+        glPointSize(command.size);
+      else
+        glLineWidth(command.size);
+
+      glDrawArrays(command.mode, command.first, count);
+      ++drawCalls;
+      i = j;
+    }
+
+    glDisableClientState(GL_COLOR_ARRAY);
+    glDisableClientState(GL_VERTEX_ARRAY);
+  }
+
+  /// Draw calls issued by the last execute().
+  inline size_t getDrawCalls() const
+  {
+    return drawCalls;
+  }
+
+}; // end class GLVertexArrayBackend
+
+} // end namespace Utils
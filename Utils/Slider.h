@@ -3,6 +3,7 @@
 #include <GL/glut.h>
 #include "Point2D.h"
 #include "Line.h"
+#include "Damage.h"
 
 namespace Utils
 {
@@ -19,6 +20,14 @@ private:
   GLfloat handleSize = 12.0;
   Color handleColor = DARK_GREEN;
 
+  /// Damage the window around the handle.
+  inline void damageHandle() const
+  {
+    GLint r = static_cast<GLint>(std::ceil(handle.size / 2)) + 1;
+    Damage::add(handle.x() - r, handle.y() - r, handle.x() + r + 1,
+                handle.y() + r + 1);
+  }
+
   inline void init()
   {
     this->body.color = this->bodyColor;
@@ -75,8 +84,9 @@ public:
     GLint x1 = body.x1();
     GLint x2 = body.x2();
 
-    if (pos >= x1 && pos <= x2)
+    if (pos >= x1 && pos <= x2 && pos != handle.x())
     {
+      damageHandle();
       this->handle.setX(pos);
 
       if (pos < x1)
@@ -85,6 +95,7 @@ public:
       if (pos > x2)
         this->handle.setX(x2);
 
+      damageHandle();
       updateValue();
     }
   }
@@ -0,0 +1,727 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+#include "Color.h"
+#include "Render.h"
+
+namespace Utils
+{
+
+// ----------------------------------------------------------------------------
+// RGBA8 image, row 0 at the bottom like the GL window.
+// ----------------------------------------------------------------------------
+class Framebuffer
+{
+private:
+  size_t width;
+  size_t height;
+
+public:
+  std::vector<uint8_t> pixels;
+
+  Framebuffer(size_t width, size_t height)
+    : width(width), height(height), pixels(4 * width * height, 0)
+  {}
+
+  virtual ~Framebuffer()
+  {}
+
+  inline size_t getWidth() const
+  {
+    return width;
+  }
+
+  inline size_t getHeight() const
+  {
+    return height;
+  }
+
+  void clear(const Color& color)
+  {
+    for (size_t i = 0; i < width * height; ++i)
+    {
+      pixels[4 * i + 0] = color.red();
+      pixels[4 * i + 1] = color.green();
+      pixels[4 * i + 2] = color.blue();
+      pixels[4 * i + 3] = color.alpha();
+    }
+  }
+
+  /// Blend rgba over the pixel, scaling its alpha by coverage in [0, 1].
+  inline void blend(long x, long y, const uint8_t *rgba, float coverage = 1)
+  {
+    if (x < 0 || y < 0 || x >= static_cast<long>(width) ||
+        y >= static_cast<long>(height))
+      return;
+
+    uint8_t *pixel = &pixels[4 * (y * width + x)];
+    float a = rgba[3] / 255.0f * coverage;
+
+    for (int c = 0; c < 3; ++c)
+      pixel[c] = static_cast<uint8_t>(rgba[c] * a + pixel[c] * (1 - a) + 0.5f);
+
+    pixel[3] = static_cast<uint8_t>(std::max<float>(pixel[3], a * 255));
+  }
+
+  /// Blend rgba over pixels [x0, x1) of row y. The loops have no branches
+  /// and work on whole rows, so the compiler can vectorize them.
+  void fillSpan(long x0, long x1, long y, const uint8_t *rgba)
+  {
+    if (y < 0 || y >= static_cast<long>(height))
+      return;
+
+    x0 = std::max(x0, 0L);
+    x1 = std::min(x1, static_cast<long>(width));
+
+    if (x0 >= x1)
+      return;
+
+    uint8_t *row = &pixels[4 * (y * width + x0)];
+    size_t count = static_cast<size_t>(x1 - x0);
+
+    if (rgba[3] == 255)
+    {
+      for (size_t i = 0; i < count; ++i)
+        std::memcpy(row + 4 * i, rgba, 4);
+
+      return;
+    }
+
+    unsigned a = rgba[3];
+    unsigned src[3] = { rgba[0] * a, rgba[1] * a, rgba[2] * a };
+
+    for (size_t i = 0; i < count; ++i)
+    {
+      uint8_t *pixel = row + 4 * i;
+
+      for (int c = 0; c < 3; ++c)
+        pixel[c] = static_cast<uint8_t>((src[c] + pixel[c] * (255 - a) + 127) /
+                                        255);
+
+      pixel[3] = std::max(pixel[3], rgba[3]);
+    }
+  }
+
+  /// Blend a color gradient over pixels [x0, x1) of row y. rgba is the color
+  /// at the center of pixel x0 and step its change per pixel, components in
+  /// [0, 255].
+  void shadeSpan(long x0, long x1, long y, const float *rgba,
+                 const float *step)
+  {
+    if (y < 0 || y >= static_cast<long>(height))
+      return;
+
+    long start = std::max(x0, 0L);
+    x1 = std::min(x1, static_cast<long>(width));
+
+    if (start >= x1)
+      return;
+
+    uint8_t *row = &pixels[4 * (y * width + start)];
+    size_t count = static_cast<size_t>(x1 - start);
+    float color[4];
+
+    for (int c = 0; c < 4; ++c)
+      color[c] = rgba[c] + (start - x0) * step[c];
+
+    for (size_t i = 0; i < count; ++i)
+    {
+      uint8_t *pixel = row + 4 * i;
+      float a = std::min(std::max(color[3], 0.0f), 255.0f) / 255.0f;
+
+      for (int c = 0; c < 3; ++c)
+      {
+        float src = std::min(std::max(color[c], 0.0f), 255.0f);
+        pixel[c] = static_cast<uint8_t>(src * a + pixel[c] * (1 - a) + 0.5f);
+      }
+
+      pixel[3] = static_cast<uint8_t>(std::max<float>(pixel[3], a * 255));
+
+      for (int c = 0; c < 4; ++c)
+        color[c] += step[c];
+    }
+  }
+
+  /// Write as binary PPM, top row first.
+  bool writePPM(const std::string& path) const
+  {
+    std::ofstream file(path, std::ios::binary);
+
+    if (!file)
+      return false;
+
+    file << "P6\n" << width << " " << height << "\n255\n";
+    std::vector<char> row(3 * width);
+
+    for (size_t y = height; y-- > 0;)
+    {
+      for (size_t x = 0; x < width; ++x)
+        for (int c = 0; c < 3; ++c)
+          row[3 * x + c] = static_cast<char>(pixels[4 * (y * width + x) + c]);
+
+      file.write(row.data(), row.size());
+    }
+
+    return static_cast<bool>(file);
+  }
+
+}; // end class Framebuffer
+
+// ----------------------------------------------------------------------------
+// Rasterizes recorded command buffers into a Framebuffer without GL. World
+// coordinates are mapped like gluOrtho2D(left, right, bottom, top).
+// Polygons, also concave ones, are filled with their vertex colors
+// interpolated along the edges and across each span. Lines are anti-aliased
+// like GL_LINE_SMOOTH unless smoothLines is off: Wu's algorithm for thin
+// lines, coverage spans for wide ones.
+// ----------------------------------------------------------------------------
+class SoftwareBackend : public RenderBackend
+{
+private:
+  Framebuffer& target;
+  double left;
+  double right;
+  double bottom;
+  double top;
+
+  struct Edge
+  {
+    float x;
+    float slope;
+    long first;
+    long last;
+    int winding;
+
+    // color at the current scanline and its change per scanline
+    float color[4];
+    float colorSlope[4];
+  };
+
+  struct Span
+  {
+    long y;
+    long x0;
+    long x1;
+
+    // color at the center of pixel x0 and its change per pixel
+    float color[4];
+    float step[4];
+  };
+
+  // scratch buffers for one command, in pixel coordinates
+  std::vector<float> xs;
+  std::vector<float> ys;
+  std::vector<float> colors;
+  std::vector<Edge> edges;
+  std::vector<Edge> active;
+  std::vector<Span> spans;
+  std::vector<float> coverage;
+
+  inline void toPixel(const CommandBuffer& buffer, uint32_t i, float& x,
+                      float& y) const
+  {
+    x = static_cast<float>((buffer.positions[2 * i] - left) / (right - left) *
+                           target.getWidth());
+    y = static_cast<float>((buffer.positions[2 * i + 1] - bottom) /
+                           (top - bottom) * target.getHeight());
+  }
+
+  void point(float x, float y, float size, const uint8_t *rgba)
+  {
+    long s = std::max(1L, std::lround(size));
+    long x0 = static_cast<long>(std::floor(x - s / 2.0f + 0.5f));
+    long y0 = static_cast<long>(std::floor(y - s / 2.0f + 0.5f));
+
+    for (long py = y0; py < y0 + s; ++py)
+      for (long px = x0; px < x0 + s; ++px)
+        target.blend(px, py, rgba);
+  }
+
+  /// Bresenham line, widened by stamping across its minor axis.
+  void bresenhamLine(float x0f, float y0f, float x1f, float y1f, float width,
+                     const uint8_t *rgba)
+  {
+    long x0 = static_cast<long>(std::floor(x0f));
+    long y0 = static_cast<long>(std::floor(y0f));
+    long x1 = static_cast<long>(std::floor(x1f));
+    long y1 = static_cast<long>(std::floor(y1f));
+    long dx = std::abs(x1 - x0), sx = x0 < x1 ? 1 : -1;
+    long dy = -std::abs(y1 - y0), sy = y0 < y1 ? 1 : -1;
+    long error = dx + dy;
+    long w = std::max(1L, std::lround(width));
+    bool steep = -dy > dx;
+
+    while (true)
+    {
+      for (long k = -(w - 1) / 2; k <= w / 2; ++k)
+      {
+        if (steep)
+          target.blend(x0 + k, y0, rgba);
+        else
+          target.blend(x0, y0 + k, rgba);
+      }
+
+      if (x0 == x1 && y0 == y1)
+        break;
+
+      long e2 = 2 * error;
+
+      if (e2 >= dy)
+      {
+        error += dy;
+        x0 += sx;
+      }
+
+      if (e2 <= dx)
+      {
+        error += dx;
+        y0 += sy;
+      }
+    }
+  }
+
+  /// Xiaolin Wu's line, one pixel wide, spreading every step over the two
+  /// pixels nearest to the line.
+  void wuLine(float x0, float y0, float x1, float y1, const uint8_t *rgba)
+  {
+    // integer coordinates at pixel centers
+    x0 -= 0.5f;
+    y0 -= 0.5f;
+    x1 -= 0.5f;
+    y1 -= 0.5f;
+
+    bool steep = std::fabs(y1 - y0) > std::fabs(x1 - x0);
+
+    if (steep)
+    {
+      std::swap(x0, y0);
+      std::swap(x1, y1);
+    }
+
+    if (x0 > x1)
+    {
+      std::swap(x0, x1);
+      std::swap(y0, y1);
+    }
+
+    float dx = x1 - x0;
+    float gradient = dx == 0 ? 1 : (y1 - y0) / dx;
+
+    auto plot = [&](long u, long v, float c)
+    {
+      if (steep)
+        target.blend(v, u, rgba, c);
+      else
+        target.blend(u, v, rgba, c);
+    };
+
+    auto fraction = [](float value)
+    {
+      return value - std::floor(value);
+    };
+
+    // endpoints cover their pixel partially along the major axis
+    float xEnd = std::round(x0);
+    float yEnd = y0 + gradient * (xEnd - x0);
+    float gap = 1 - fraction(x0 + 0.5f);
+    long first = static_cast<long>(xEnd);
+    long y = static_cast<long>(std::floor(yEnd));
+    plot(first, y, (1 - fraction(yEnd)) * gap);
+    plot(first, y + 1, fraction(yEnd) * gap);
+    float intersection = yEnd + gradient;
+
+    xEnd = std::round(x1);
+    yEnd = y1 + gradient * (xEnd - x1);
+    gap = fraction(x1 + 0.5f);
+    long last = static_cast<long>(xEnd);
+    y = static_cast<long>(std::floor(yEnd));
+    plot(last, y, (1 - fraction(yEnd)) * gap);
+    plot(last, y + 1, fraction(yEnd) * gap);
+
+    for (long x = first + 1; x < last; ++x)
+    {
+      y = static_cast<long>(std::floor(intersection));
+      float f = intersection - y;
+      plot(x, y, 1 - f);
+      plot(x, y + 1, f);
+      intersection += gradient;
+    }
+  }
+
+  /// Anti-aliased line of any width with butt ends. Each step along the
+  /// major axis covers a span across the minor axis; the coverage of the
+  /// whole span is computed in one branch-free loop before blending.
+  void wideLine(float x0, float y0, float x1, float y1, float width,
+                const uint8_t *rgba)
+  {
+    bool steep = std::fabs(y1 - y0) > std::fabs(x1 - x0);
+
+    if (steep)
+    {
+      std::swap(x0, y0);
+      std::swap(x1, y1);
+    }
+
+    if (x0 > x1)
+    {
+      std::swap(x0, x1);
+      std::swap(y0, y1);
+    }
+
+    float du = x1 - x0;
+    float dv = y1 - y0;
+    float length = std::sqrt(du * du + dv * dv);
+
+    if (length == 0)
+      return;
+
+    float cosine = du / length;
+    float slope = dv / du;
+    float half = width / 2;
+
+    // distance across the minor axis the line reaches, and how far the
+    // butt ends reach along the major axis
+    float reach = half / cosine + 1;
+    float overhang = half * std::fabs(dv) / length + 1;
+
+    long uFirst = static_cast<long>(std::floor(x0 - overhang));
+    long uLast = static_cast<long>(std::ceil(x1 + overhang));
+    long size = static_cast<long>(2 * std::ceil(reach)) + 2;
+    coverage.resize(size);
+
+    for (long u = uFirst; u <= uLast; ++u)
+    {
+      float pu = u + 0.5f;
+      float center = y0 + (pu - x0) * slope;
+      long vFirst = static_cast<long>(std::floor(center - reach));
+      float along = (pu - x0) * cosine;
+      float *c = coverage.data();
+
+      for (long k = 0; k < size; ++k)
+      {
+        float pv = vFirst + k + 0.5f;
+        float across = std::fabs(pv - center) * cosine;
+        float t = along + (pv - y0) * (dv / length);
+        float side = std::min(std::max(half + 0.5f - across, 0.0f), 1.0f);
+        float start = std::min(std::max(t + 0.5f, 0.0f), 1.0f);
+        float end = std::min(std::max(length - t + 0.5f, 0.0f), 1.0f);
+        c[k] = side * start * end;
+      }
+
+      for (long k = 0; k < size; ++k)
+      {
+        if (c[k] <= 0)
+          continue;
+
+        if (steep)
+          target.blend(vFirst + k, u, rgba, c[k]);
+        else
+          target.blend(u, vFirst + k, rgba, c[k]);
+      }
+    }
+  }
+
+  void line(float x0, float y0, float x1, float y1, float width,
+            const uint8_t *rgba)
+  {
+    if (!smoothLines)
+      this->bresenhamLine(x0, y0, x1, y1, width, rgba);
+    else if (width <= 1.5f)
+      this->wuLine(x0, y0, x1, y1, rgba);
+    else
+      this->wideLine(x0, y0, x1, y1, width, rgba);
+  }
+
+  /// Scanline fill of the polygon in xs, ys with an active edge table,
+  /// sampled at pixel centers. Works for concave and self-intersecting
+  /// polygons. Spans are collected first and filled in one batch, flat in
+  /// rgba or, if rgba is nullptr, shaded from the vertex colors in colors.
+  void polygon(const uint8_t *rgba)
+  {
+    size_t n = xs.size();
+
+    if (n < 3)
+      return;
+
+    // edge table, sorted by first scanline
+    edges.clear();
+
+    for (size_t i = 0, j = n - 1; i < n; j = i++)
+    {
+      float xa = xs[j], ya = ys[j], xb = xs[i], yb = ys[i];
+      size_t a = j, b = i;
+      int winding = 1;
+
+      if (ya > yb)
+      {
+        std::swap(xa, xb);
+        std::swap(ya, yb);
+        std::swap(a, b);
+        winding = -1;
+      }
+
+      long first = static_cast<long>(std::ceil(ya - 0.5f));
+      long last = static_cast<long>(std::ceil(yb - 0.5f));
+
+      // horizontal edges cross no scanline center
+      if (first >= last)
+        continue;
+
+      float slope = (xb - xa) / (yb - ya);
+      Edge edge = { xa + (first + 0.5f - ya) * slope, slope, first, last,
+                    winding, { 0, 0, 0, 0 }, { 0, 0, 0, 0 } };
+
+      if (!rgba)
+      {
+        for (int c = 0; c < 4; ++c)
+        {
+          float ca = colors[4 * a + c], cb = colors[4 * b + c];
+          edge.colorSlope[c] = (cb - ca) / (yb - ya);
+          edge.color[c] = ca + (first + 0.5f - ya) * edge.colorSlope[c];
+        }
+      }
+
+      edges.push_back(edge);
+    }
+
+    std::sort(edges.begin(), edges.end(), [](const Edge & a, const Edge & b)
+    {
+      return a.first < b.first;
+    });
+
+    if (edges.empty())
+      return;
+
+    long height = static_cast<long>(target.getHeight());
+    long y = std::max(0L, edges.front().first);
+    size_t next = 0;
+    active.clear();
+    spans.clear();
+
+    while (y < height && (next < edges.size() || !active.empty()))
+    {
+      // edges entering at this scanline, or before a clipped start
+      for (; next < edges.size() && edges[next].first <= y; ++next)
+      {
+        Edge edge = edges[next];
+
+        if (edge.last <= y)
+          continue;
+
+        edge.x += (y - edge.first) * edge.slope;
+
+        for (int c = 0; c < 4; ++c)
+          edge.color[c] += (y - edge.first) * edge.colorSlope[c];
+
+        active.push_back(edge);
+      }
+
+      // leaving edges
+      active.erase(std::remove_if(active.begin(), active.end(),
+                                  [y](const Edge & edge)
+      {
+        return edge.last <= y;
+      }), active.end());
+
+      // active edges move little between scanlines, insertion sort is
+      // close to linear
+      for (size_t i = 1; i < active.size(); ++i)
+      {
+        Edge edge = active[i];
+        size_t j = i;
+
+        for (; j > 0 && active[j - 1].x > edge.x; --j)
+          active[j] = active[j - 1];
+
+        active[j] = edge;
+      }
+
+      int winding = 0;
+
+      for (size_t i = 0; i + 1 < active.size(); ++i)
+      {
+        winding += fillRule == EVEN_ODD ? 1 : active[i].winding;
+        bool inside = fillRule == EVEN_ODD ? (winding & 1) != 0 : winding != 0;
+
+        if (!inside)
+          continue;
+
+        const Edge& l = active[i];
+        const Edge& r = active[i + 1];
+        Span span = { y, static_cast<long>(std::ceil(l.x - 0.5f)),
+                      static_cast<long>(std::ceil(r.x - 0.5f)),
+                      { 0, 0, 0, 0 }, { 0, 0, 0, 0 } };
+
+        if (!rgba && r.x > l.x)
+        {
+          for (int c = 0; c < 4; ++c)
+          {
+            span.step[c] = (r.color[c] - l.color[c]) / (r.x - l.x);
+            span.color[c] = l.color[c] + (span.x0 + 0.5f - l.x) * span.step[c];
+          }
+        }
+
+        spans.push_back(span);
+      }
+
+      for (auto& edge : active)
+      {
+        edge.x += edge.slope;
+
+        for (int c = 0; c < 4; ++c)
+          edge.color[c] += edge.colorSlope[c];
+      }
+
+      ++y;
+    }
+
+    if (rgba)
+    {
+      for (const auto& span : spans)
+        target.fillSpan(span.x0, span.x1, span.y, rgba);
+    }
+    else
+    {
+      for (const auto& span : spans)
+        target.shadeSpan(span.x0, span.x1, span.y, span.color, span.step);
+    }
+  }
+
+  /// Fill a polygon, shaded unless all its vertices have the same color.
+  void fill(const CommandBuffer& buffer, uint32_t first, uint32_t count)
+  {
+    const uint8_t *rgba = &buffer.colors[4 * first];
+    bool flat = true;
+    xs.clear();
+    ys.clear();
+    colors.clear();
+
+    for (uint32_t i = first; i < first + count; ++i)
+    {
+      float x, y;
+      toPixel(buffer, i, x, y);
+      xs.push_back(x);
+      ys.push_back(y);
+
+      const uint8_t *vertex = &buffer.colors[4 * i];
+      flat = flat && std::memcmp(vertex, rgba, 4) == 0;
+      colors.insert(colors.end(), vertex, vertex + 4);
+    }
+
+    this->polygon(flat ? rgba : nullptr);
+  }
+
+public:
+  enum FillRule
+  {
+    EVEN_ODD,
+    NON_ZERO
+  };
+
+  /// Anti-alias lines, like GL_LINE_SMOOTH.
+  bool smoothLines = true;
+
+  /// Inside test for self-overlapping polygons.
+  FillRule fillRule = EVEN_ODD;
+
+  SoftwareBackend(Framebuffer& target, double left, double right,
+                  double bottom, double top)
+    : target(target)
+  {
+    this->setProjection(left, right, bottom, top);
+  }
+
+  virtual ~SoftwareBackend()
+  {}
+
+  inline void setProjection(double left, double right, double bottom,
+                            double top)
+  {
+    this->left = left;
+    this->right = right;
+    this->bottom = bottom;
+    this->top = top;
+  }
+
+  virtual void execute(const CommandBuffer& buffer)
+  {
+    for (const auto& command : buffer.commands)
+    {
+      uint32_t first = command.first;
+      uint32_t count = command.count;
+      uint32_t end = first + count;
+      float ax, ay, bx, by;
+
+      switch (command.mode)
+      {
+      case GL_POINTS:
+        for (uint32_t i = first; i < end; ++i)
+        {
+          toPixel(buffer, i, ax, ay);
+          this->point(ax, ay, command.size, &buffer.colors[4 * i]);
+        }
+
+        break;
+
+      case GL_LINES:
+        for (uint32_t i = first; i + 1 < end; i += 2)
+        {
+          toPixel(buffer, i, ax, ay);
+          toPixel(buffer, i + 1, bx, by);
+          this->line(ax, ay, bx, by, command.size, &buffer.colors[4 * i]);
+        }
+
+        break;
+
+      case GL_LINE_STRIP:
+      case GL_LINE_LOOP:
+        for (uint32_t i = first; i + 1 < end; ++i)
+        {
+          toPixel(buffer, i, ax, ay);
+          toPixel(buffer, i + 1, bx, by);
+          this->line(ax, ay, bx, by, command.size, &buffer.colors[4 * i]);
+        }
+
+        if (command.mode == GL_LINE_LOOP && count > 2)
+        {
+          toPixel(buffer, end - 1, ax, ay);
+          toPixel(buffer, first, bx, by);
+          this->line(ax, ay, bx, by, command.size,
+                     &buffer.colors[4 * (end - 1)]);
+        }
+
+        break;
+
+      case GL_TRIANGLES:
+        for (uint32_t i = first; i + 2 < end; i += 3)
+          this->fill(buffer, i, 3);
+
+        break;
+
+      case GL_QUADS:
+        for (uint32_t i = first; i + 3 < end; i += 4)
+          this->fill(buffer, i, 4);
+
+        break;
+
+      case GL_TRIANGLE_FAN:
+      case GL_POLYGON:
+        // a fan covers the same area as its outline
+        this->fill(buffer, first, count);
+        break;
+
+      default:
+        break;
+      }
+    }
+  }
+
+}; // end class SoftwareBackend
+
+} // end namespace Utils
@@ -25,7 +25,9 @@ private:
     this->points.clear();
 
     // calculate points -------------------------------------------------------
-    double step = Utils::PI / this->segments;
+    // both angles step by PI / segments, so one table of 2 * segments
+    // entries covers theta and phi alike
+    const TrigTable& trig = trigTable(segment2);
 
     // add top Z point
     this->points.emplace_back();
@@ -34,18 +36,22 @@ private:
     );
 
     // add points in a circular fashion
-    for (double phi = step; phi < Utils::PI; phi += step)
+    for (size_t i = 1; i < this->segments; ++i)
     {
       // start columns
       this->points.emplace_back();
+      this->points.back().reserve(segment2);
 
-      for (double theta = 0; theta < 2 * Utils::PI; theta += step)
+      double sinPhi = trig.sin[i];
+      double cosPhi = trig.cos[i];
+
+      for (size_t j = 0; j < segment2; ++j)
       {
         // fill rows
         this->points.back().emplace_back(
-          this->center.x() + this->radius * std::cos(theta) * std::sin(phi),
-          this->center.y() + this->radius * std::sin(theta) * std::sin(phi),
-          this->center.z() + this->radius * std::cos(phi)
+          this->center.x() + this->radius * trig.cos[j] * sinPhi,
+          this->center.y() + this->radius * trig.sin[j] * sinPhi,
+          this->center.z() + this->radius * cosPhi
         );
       }
     }
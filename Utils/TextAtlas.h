@@ -0,0 +1,312 @@
+#pragma once
+
+#include <GL/freeglut.h>
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+#include "Render.h"
+
+namespace Utils
+{
+
+// ----------------------------------------------------------------------------
+// The printable ASCII glyphs of a GLUT bitmap font in one alpha texture.
+// GLUT keeps its glyph bitmaps private, so the atlas draws every glyph once
+// with glBitmap into a corner of the back buffer and reads it back, putting
+// the previous pixels back afterwards. It is built on first use and needs a
+// window; without one it stays empty and text falls back to bitmaps.
+// ----------------------------------------------------------------------------
+class GlyphAtlas
+{
+private:
+  static const int FIRST = 32;
+  static const int LAST = 126;
+  static const int COLUMNS = 16;
+  static const int PADDING = 2;
+
+  void *font;
+  GLuint texture = 0;
+  bool built = false;
+  GLint textureWidth = 0;
+  GLint textureHeight = 0;
+  GLint lineHeight = 0;
+  GLint cellWidth = 0;
+  GLint cellHeight = 0;
+  GLint advances[LAST - FIRST + 1];
+
+  static GLint powerOfTwo(GLint n)
+  {
+    GLint p = 1;
+
+    while (p < n)
+      p *= 2;
+
+    return p;
+  }
+
+  void build()
+  {
+    built = true;
+
+    // without a context there is nothing to read back
+    if (!glGetString(GL_VERSION))
+      return;
+
+    lineHeight = glutBitmapHeight(font);
+    GLint widest = 0;
+
+    for (int c = FIRST; c <= LAST; ++c)
+    {
+      advances[c - FIRST] = glutBitmapWidth(font, c);
+      widest = std::max(widest, advances[c - FIRST]);
+    }
+
+    // the glyph origin sits in the middle of its cell, so descenders and
+    // overhangs are captured without knowing the font's offsets
+    cellWidth = widest + 2 * PADDING;
+    cellHeight = 2 * lineHeight;
+
+    const int rows = (LAST - FIRST + COLUMNS) / COLUMNS;
+    GLint width = COLUMNS * cellWidth;
+    GLint height = rows * cellHeight;
+    GLint viewport[4];
+    glGetIntegerv(GL_VIEWPORT, viewport);
+
+    if (width > viewport[2] || height > viewport[3])
+      return;
+
+    glPushAttrib(GL_ALL_ATTRIB_BITS);
+    glPushClientAttrib(GL_CLIENT_PIXEL_STORE_BIT);
+    glMatrixMode(GL_PROJECTION);
+    glPushMatrix();
+    glLoadIdentity();
+    glOrtho(0, viewport[2], 0, viewport[3], -1, 1);
+    glMatrixMode(GL_MODELVIEW);
+    glPushMatrix();
+    glLoadIdentity();
+
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glDisable(GL_BLEND);
+    glDisable(GL_DITHER);
+    glDisable(GL_TEXTURE_2D);
+
+    std::vector<GLubyte> saved(4 * width * height);
+    glReadPixels(viewport[0], viewport[1], width, height, GL_RGBA,
+                 GL_UNSIGNED_BYTE, saved.data());
+
+    glEnable(GL_SCISSOR_TEST);
+    glScissor(viewport[0], viewport[1], width, height);
+    glClearColor(0, 0, 0, 0);
+    glClear(GL_COLOR_BUFFER_BIT);
+    glColor3f(1, 1, 1);
+
+    for (int c = FIRST; c <= LAST; ++c)
+    {
+      int i = c - FIRST;
+      glRasterPos2i(i % COLUMNS * cellWidth + PADDING,
+                    i / COLUMNS * cellHeight + lineHeight);
+      glutBitmapCharacter(font, c);
+    }
+
+    textureWidth = powerOfTwo(width);
+    textureHeight = powerOfTwo(height);
+    std::vector<GLubyte> alpha(textureWidth * textureHeight, 0);
+    std::vector<GLubyte> glyphs(width * height);
+    glReadPixels(viewport[0], viewport[1], width, height, GL_RED,
+                 GL_UNSIGNED_BYTE, glyphs.data());
+
+    for (GLint y = 0; y < height; ++y)
+      std::memcpy(&alpha[y * textureWidth], &glyphs[y * width], width);
+
+    glRasterPos2i(0, 0);
+    glDrawPixels(width, height, GL_RGBA, GL_UNSIGNED_BYTE, saved.data());
+
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_ALPHA8, textureWidth, textureHeight, 0,
+                 GL_ALPHA, GL_UNSIGNED_BYTE, alpha.data());
+
+    glMatrixMode(GL_PROJECTION);
+    glPopMatrix();
+    glMatrixMode(GL_MODELVIEW);
+    glPopMatrix();
+    glPopClientAttrib();
+    glPopAttrib();
+  }
+
+public:
+  explicit GlyphAtlas(void *font) : font(font) {}
+
+  GlyphAtlas(const GlyphAtlas&) = delete;
+  GlyphAtlas& operator=(const GlyphAtlas&) = delete;
+
+  virtual ~GlyphAtlas()
+  {
+    if (texture && glGetString(GL_VERSION))
+      glDeleteTextures(1, &texture);
+  }
+
+  /// Shared atlas of a GLUT bitmap font.
+  static GlyphAtlas& get(void *font)
+  {
+    static std::vector<std::unique_ptr<GlyphAtlas>> atlases;
+
+    for (const auto& atlas : atlases)
+      if (atlas->font == font)
+        return *atlas;
+
+    atlases.emplace_back(new GlyphAtlas(font));
+    return *atlases.back();
+  }
+
+  /// Build the texture if needed, false if there is none.
+  inline bool ready()
+  {
+    if (!built)
+      this->build();
+
+    return texture != 0;
+  }
+
+  inline void *getFont() const
+  {
+    return font;
+  }
+
+  inline GLuint getTexture() const
+  {
+    return texture;
+  }
+
+  /// Append quads for text with its first line starting at the origin, like
+  /// glutBitmapString: x, y and u, v per vertex.
+  void layout(const std::string& text, std::vector<GLfloat>& vertices) const
+  {
+    const GLfloat du = 1.0f / textureWidth;
+    const GLfloat dv = 1.0f / textureHeight;
+    GLint x = 0;
+    GLint y = 0;
+
+    for (unsigned char c : text)
+    {
+      if (c == '\n')
+      {
+        x = 0;
+        y -= lineHeight;
+        continue;
+      }
+
+      if (c < FIRST || c > LAST)
+        continue;
+
+      int i = c - FIRST;
+      GLfloat u0 = i % COLUMNS * cellWidth * du;
+      GLfloat v0 = i / COLUMNS * cellHeight * dv;
+      GLfloat u1 = u0 + cellWidth * du;
+      GLfloat v1 = v0 + cellHeight * dv;
+      GLfloat x0 = static_cast<GLfloat>(x - PADDING);
+      GLfloat y0 = static_cast<GLfloat>(y - lineHeight);
+      GLfloat x1 = x0 + cellWidth;
+      GLfloat y1 = y0 + cellHeight;
+      const GLfloat quad[] = { x0, y0, u0, v0, x1, y0, u1, v0,
+                               x1, y1, u1, v1, x0, y1, u0, v1
+                             };
+
+      vertices.insert(vertices.end(), quad, quad + 16);
+      x += advances[i];
+    }
+  }
+
+}; // end class GlyphAtlas
+
+// ----------------------------------------------------------------------------
+// A piece of text drawn from a glyph atlas. The quads are laid out again only
+// when the text changes, so an unchanged overlay costs one draw call and no
+// allocation.
+// ----------------------------------------------------------------------------
+class TextLabel
+{
+private:
+  GlyphAtlas& atlas;
+  std::string text;
+  std::vector<GLfloat> vertices;
+  bool valid = false;
+  size_t layouts = 0;
+
+public:
+  explicit TextLabel(void *font = GLUT_BITMAP_HELVETICA_18)
+    : atlas(GlyphAtlas::get(font))
+  {}
+
+  virtual ~TextLabel()
+  {}
+
+  /// Draw text in the current color at window position x, y. Like
+  /// renderText it is not recorded.
+  void draw(GLint x, GLint y, const char *text)
+  {
+    if (recordingBuffer())
+      return;
+
+    if (!atlas.ready())
+    {
+      glRasterPos2i(x, y);
+      glutBitmapString(atlas.getFont(),
+                       reinterpret_cast<const unsigned char *>(text));
+      return;
+    }
+
+    if (!valid || this->text != text)
+    {
+      this->text = text;
+      vertices.clear();
+      atlas.layout(this->text, vertices);
+      valid = true;
+      ++layouts;
+    }
+
+    if (vertices.empty())
+      return;
+
+    glPushAttrib(GL_ENABLE_BIT | GL_TEXTURE_BIT | GL_COLOR_BUFFER_BIT);
+    glPushClientAttrib(GL_CLIENT_VERTEX_ARRAY_BIT);
+    glEnable(GL_TEXTURE_2D);
+    glBindTexture(GL_TEXTURE_2D, atlas.getTexture());
+    glTexEnvi(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+    glEnableClientState(GL_VERTEX_ARRAY);
+    glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+    glVertexPointer(2, GL_FLOAT, 4 * sizeof(GLfloat), vertices.data());
+    glTexCoordPointer(2, GL_FLOAT, 4 * sizeof(GLfloat), vertices.data() + 2);
+
+    glMatrixMode(GL_MODELVIEW);
+    glPushMatrix();
+    glTranslatef(static_cast<GLfloat>(x), static_cast<GLfloat>(y), 0);
+    glDrawArrays(GL_QUADS, 0, static_cast<GLsizei>(vertices.size() / 4));
+    glPopMatrix();
+
+    glPopClientAttrib();
+    glPopAttrib();
+  }
+
+  inline void draw(GLint x, GLint y, const std::string& text)
+  {
+    this->draw(x, y, text.c_str());
+  }
+
+  /// Times the text was laid out.
+  inline size_t getLayouts() const
+  {
+    return layouts;
+  }
+
+}; // end class TextLabel
+
+} // end namespace Utils
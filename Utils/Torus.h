@@ -24,21 +24,24 @@ private:
     this->points.clear();
 
     // calculate points -------------------------------------------------------
-    double step = 2 * Utils::PI / this->segments;
+    const TrigTable& trig = trigTable(this->segments);
 
     // add points in a circular fashion
-    for (double phi = 0.0f; phi < 2 * Utils::PI; phi += step)
+    for (size_t i = 0; i < this->segments; ++i)
     {
       // start columns
       this->points.emplace_back();
+      this->points.back().reserve(this->segments);
 
-      for (double theta = 0.0f; theta < 2 * Utils::PI; theta += step)
+      for (size_t j = 0; j < this->segments; ++j)
       {
+        T ring = this->R + this->r * trig.cos[j];
+
         // fill rows
         this->points.back().emplace_back(
-          this->center.x() + (this->R + this->r * std::cos(theta)) * std::cos(phi),
-          this->center.y() + (this->R + this->r * std::cos(theta)) * std::sin(phi),
-          this->center.z() + this->r * std::sin(theta)
+          this->center.x() + ring * trig.cos[i],
+          this->center.y() + ring * trig.sin[i],
+          this->center.z() + this->r * trig.sin[j]
         );
       }
     }
@@ -51,31 +54,16 @@ private:
     {
       for (size_t j = 0; j < this->segments; ++j)
       {
-        // create face
+        // create face, wrapping around in both directions
+        size_t nextI = (i + 1) % this->segments;
+        size_t nextJ = (j + 1) % this->segments;
         Face face;
         face.vertices.resize(4);
 
         face.vertices[0] = &this->points[i][j];
-        face.vertices[1] = &this->points[i + 1][j];
-        face.vertices[2] = &this->points[i + 1][j + 1];
-        face.vertices[3] = &this->points[i][j + 1];
-
-        if (j == this->segments - 1)
-        {
-          face.vertices[2] = &this->points[i + 1][0];
-          face.vertices[3] = &this->points[i][0];
-        }
-
-        if (i == this->segments - 1)
-        {
-          face.vertices[1] = &this->points[0][j];
-          face.vertices[2] = &this->points[0][j + 1];
-
-          if (j == this->segments - 1)
-          {
-            face.vertices[2] = &this->points[0][0];
-          }
-        }
+        face.vertices[1] = &this->points[nextI][j];
+        face.vertices[2] = &this->points[nextI][nextJ];
+        face.vertices[3] = &this->points[i][nextJ];
 
         this->prepareFace(face);
 
@@ -0,0 +1,502 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <numeric>
+#include <set>
+#include <vector>
+
+namespace Utils
+{
+
+// ----------------------------------------------------------------------------
+// Polygon triangulation on plain coordinate lists. Triangles are returned as
+// index triples into the input, counter-clockwise.
+// ----------------------------------------------------------------------------
+
+namespace detail
+{
+
+inline double cross(const std::vector<double>& x, const std::vector<double>& y,
+                    uint32_t o, uint32_t a, uint32_t b)
+{
+  return (x[a] - x[o]) * (y[b] - y[o]) - (y[a] - y[o]) * (x[b] - x[o]);
+}
+
+/// Twice the signed area of the polygon through ring, positive if it runs
+/// counter-clockwise.
+inline double ringArea(const std::vector<double>& x,
+                       const std::vector<double>& y,
+                       const std::vector<uint32_t>& ring)
+{
+  double area = 0;
+
+  for (size_t i = 0, j = ring.size() - 1; i < ring.size(); j = i++)
+    area += x[ring[j]] * y[ring[i]] - x[ring[i]] * y[ring[j]];
+
+  return area;
+}
+
+inline void addTriangle(const std::vector<double>& x,
+                        const std::vector<double>& y, uint32_t a, uint32_t b,
+                        uint32_t c, std::vector<uint32_t>& triangles)
+{
+  if (cross(x, y, a, b, c) < 0)
+    std::swap(b, c);
+
+  triangles.push_back(a);
+  triangles.push_back(b);
+  triangles.push_back(c);
+}
+
+/// Stack triangulation of a y-monotone polygon given counter-clockwise.
+inline void triangulateMonotonePiece(const std::vector<double>& x,
+                                     const std::vector<double>& y,
+                                     const std::vector<uint32_t>& piece,
+                                     std::vector<uint32_t>& triangles)
+{
+  size_t m = piece.size();
+
+  if (m < 3)
+    return;
+
+  auto above = [&](uint32_t a, uint32_t b)
+  {
+    return y[a] > y[b] || (y[a] == y[b] && x[a] < x[b]);
+  };
+
+  // counter-clockwise from the top vertex runs down the left chain
+  size_t top = 0, bottom = 0;
+
+  for (size_t i = 1; i < m; ++i)
+  {
+    if (above(piece[i], piece[top]))
+      top = i;
+
+    if (above(piece[bottom], piece[i]))
+      bottom = i;
+  }
+
+  std::vector<std::pair<uint32_t, bool>> sorted;
+  sorted.reserve(m);
+
+  for (size_t i = top; ; i = (i + 1) % m)
+  {
+    sorted.emplace_back(piece[i], true);
+
+    if (i == bottom)
+      break;
+  }
+
+  for (size_t i = (bottom + 1) % m; i != top; i = (i + 1) % m)
+    sorted.emplace_back(piece[i], false);
+
+  std::sort(sorted.begin(), sorted.end(),
+            [&](const std::pair<uint32_t, bool>& a,
+                const std::pair<uint32_t, bool>& b)
+  {
+    return above(a.first, b.first);
+  });
+
+  std::vector<std::pair<uint32_t, bool>> stack;
+  stack.push_back(sorted[0]);
+  stack.push_back(sorted[1]);
+
+  for (size_t j = 2; j + 1 < m; ++j)
+  {
+    auto u = sorted[j];
+
+    if (u.second != stack.back().second)
+    {
+      // opposite chain: fan to every stacked vertex
+      for (size_t k = 0; k + 1 < stack.size(); ++k)
+        addTriangle(x, y, u.first, stack[k].first, stack[k + 1].first,
+                    triangles);
+
+      stack.clear();
+      stack.push_back(sorted[j - 1]);
+      stack.push_back(u);
+    }
+    else
+    {
+      // same chain: cut off vertices while the diagonal stays inside
+      auto last = stack.back();
+      stack.pop_back();
+
+      while (!stack.empty())
+      {
+        double turn = cross(x, y, stack.back().first, u.first, last.first);
+
+        if (u.second ? turn >= 0 : turn <= 0)
+          break;
+
+        addTriangle(x, y, u.first, last.first, stack.back().first,
+                    triangles);
+        last = stack.back();
+        stack.pop_back();
+      }
+
+      stack.push_back(last);
+      stack.push_back(u);
+    }
+  }
+
+  for (size_t k = 0; k + 1 < stack.size(); ++k)
+    addTriangle(x, y, sorted[m - 1].first, stack[k].first,
+                stack[k + 1].first, triangles);
+}
+
+} // end namespace detail
+
+// ----------------------------------------------------------------------------
+// Ear clipping in O(n^2). Works on every simple polygon; self-intersecting
+// ones still get triangles covering their outline.
+// ----------------------------------------------------------------------------
+inline void triangulateEarClipping(const std::vector<double>& x,
+                                   const std::vector<double>& y,
+                                   std::vector<uint32_t> ring,
+                                   std::vector<uint32_t>& triangles)
+{
+  if (detail::ringArea(x, y, ring) < 0)
+    std::reverse(ring.begin(), ring.end());
+
+  size_t i = 0;
+  size_t misses = 0;
+
+  while (ring.size() > 3)
+  {
+    size_t n = ring.size();
+    uint32_t a = ring[(i + n - 1) % n];
+    uint32_t b = ring[i % n];
+    uint32_t c = ring[(i + 1) % n];
+    bool ear = detail::cross(x, y, a, b, c) > 0;
+
+    for (size_t k = 0; ear && k < n; ++k)
+    {
+      uint32_t p = ring[k];
+
+      if (p == a || p == b || p == c)
+        continue;
+
+      ear = !(detail::cross(x, y, a, b, p) >= 0 &&
+              detail::cross(x, y, b, c, p) >= 0 &&
+              detail::cross(x, y, c, a, p) >= 0);
+    }
+
+    // no ear left in a degenerate polygon, clip anyway
+    if (ear || misses > n)
+    {
+      detail::addTriangle(x, y, a, b, c, triangles);
+      ring.erase(ring.begin() + i % n);
+      misses = 0;
+    }
+    else
+    {
+      i = (i + 1) % n;
+      ++misses;
+    }
+  }
+
+  if (ring.size() == 3)
+    detail::addTriangle(x, y, ring[0], ring[1], ring[2], triangles);
+}
+
+// ----------------------------------------------------------------------------
+// Sweep line decomposition into y-monotone pieces in O(n log n), after de
+// Berg et al., "Computational Geometry", chapter 3, each piece triangulated
+// in linear time. Returns false if the result does not cover the polygon,
+// which happens for self-intersecting input.
+// ----------------------------------------------------------------------------
+inline bool triangulateMonotone(const std::vector<double>& x,
+                                const std::vector<double>& y,
+                                std::vector<uint32_t> ring,
+                                std::vector<uint32_t>& triangles)
+{
+  size_t n = ring.size();
+  double area = detail::ringArea(x, y, ring);
+
+  if (area < 0)
+  {
+    std::reverse(ring.begin(), ring.end());
+    area = -area;
+  }
+
+  // positions in ring from here on, edge e runs from e to e + 1
+  auto X = [&](size_t i)
+  {
+    return x[ring[i]];
+  };
+  auto Y = [&](size_t i)
+  {
+    return y[ring[i]];
+  };
+  auto above = [&](size_t a, size_t b)
+  {
+    return Y(a) > Y(b) || (Y(a) == Y(b) && X(a) < X(b));
+  };
+  auto turn = [&](size_t o, size_t a, size_t b)
+  {
+    return detail::cross(x, y, ring[o], ring[a], ring[b]);
+  };
+
+  enum Kind { START, END, SPLIT, MERGE, REGULAR };
+  std::vector<Kind> kind(n);
+
+  for (size_t i = 0; i < n; ++i)
+  {
+    size_t prev = (i + n - 1) % n, next = (i + 1) % n;
+    bool convex = turn(prev, i, next) > 0;
+
+    if (above(i, prev) && above(i, next))
+      kind[i] = convex ? START : SPLIT;
+    else if (above(prev, i) && above(next, i))
+      kind[i] = convex ? END : MERGE;
+    else
+      kind[i] = REGULAR;
+  }
+
+  // sweep status: edges left of the interior, ordered by x at the sweep
+  // line. Edge n stands for the event point itself.
+  double sweepX = 0, sweepY = 0;
+
+  auto xAt = [&](size_t e)
+  {
+    if (e == n)
+      return sweepX;
+
+    size_t a = e, b = (e + 1) % n;
+
+    if (Y(a) == Y(b))
+      return std::min(std::max(sweepX, std::min(X(a), X(b))),
+                      std::max(X(a), X(b)));
+
+    return X(a) + (sweepY - Y(a)) * (X(b) - X(a)) / (Y(b) - Y(a));
+  };
+
+  typedef std::function<bool(size_t, size_t)> Order;
+  std::set<size_t, Order> status(Order([&](size_t a, size_t b)
+  {
+    double xa = xAt(a), xb = xAt(b);
+
+    if (xa != xb)
+      return xa < xb;
+
+    return a != b && b == n ? false : (a == n ? true : a < b);
+  }));
+
+  std::vector<std::set<size_t, Order>::iterator> position(n, status.end());
+  std::vector<size_t> helper(n, 0);
+  std::vector<std::pair<size_t, size_t>> diagonals;
+
+  auto insert = [&](size_t e, size_t v)
+  {
+    position[e] = status.insert(e).first;
+    helper[e] = v;
+  };
+  auto erase = [&](size_t e)
+  {
+    if (position[e] != status.end())
+      status.erase(position[e]);
+
+    position[e] = status.end();
+  };
+  auto connectMerge = [&](size_t e, size_t v)
+  {
+    if (kind[helper[e]] == MERGE)
+      diagonals.emplace_back(v, helper[e]);
+  };
+  auto leftOf = [&]() -> size_t
+  {
+    auto it = status.lower_bound(n);
+
+    if (it == status.begin())
+      return n;
+
+    return *--it;
+  };
+
+  std::vector<size_t> events(n);
+  std::iota(events.begin(), events.end(), 0);
+  std::sort(events.begin(), events.end(), above);
+
+  for (auto v : events)
+  {
+    size_t prev = (v + n - 1) % n;
+    sweepX = X(v);
+    sweepY = Y(v);
+
+    switch (kind[v])
+    {
+    case START:
+      insert(v, v);
+      break;
+
+    case END:
+      connectMerge(prev, v);
+      erase(prev);
+      break;
+
+    case SPLIT:
+    {
+      size_t e = leftOf();
+
+      if (e == n)
+        return false;
+
+      diagonals.emplace_back(v, helper[e]);
+      helper[e] = v;
+      insert(v, v);
+      break;
+    }
+
+    case MERGE:
+    {
+      connectMerge(prev, v);
+      erase(prev);
+      size_t e = leftOf();
+
+      if (e == n)
+        return false;
+
+      connectMerge(e, v);
+      helper[e] = v;
+      break;
+    }
+
+    case REGULAR:
+      // interior to the right when the boundary runs downwards
+      if (above(prev, v))
+      {
+        connectMerge(prev, v);
+        erase(prev);
+        insert(v, v);
+      }
+      else
+      {
+        size_t e = leftOf();
+
+        if (e == n)
+          return false;
+
+        connectMerge(e, v);
+        helper[e] = v;
+      }
+
+      break;
+    }
+  }
+
+  // split along the diagonals: walk the faces left of all half-edges,
+  // turning as far left as possible at every vertex
+  std::vector<std::vector<size_t>> outgoing(n);
+
+  for (size_t i = 0; i < n; ++i)
+    outgoing[i].push_back((i + 1) % n);
+
+  for (const auto& d : diagonals)
+  {
+    outgoing[d.first].push_back(d.second);
+    outgoing[d.second].push_back(d.first);
+  }
+
+  std::vector<std::vector<char>> used(n);
+
+  for (size_t i = 0; i < n; ++i)
+    used[i].assign(outgoing[i].size(), 0);
+
+  const double pi = std::acos(-1.0);
+  std::vector<uint32_t> piece;
+
+  for (size_t start = 0; start < n; ++start)
+  {
+    for (size_t k = 0; k < outgoing[start].size(); ++k)
+    {
+      if (used[start][k])
+        continue;
+
+      piece.clear();
+      size_t from = start, slot = k;
+
+      for (size_t guard = 0; !used[from][slot]; ++guard)
+      {
+        if (guard > n + 2 * diagonals.size())
+          return false;
+
+        used[from][slot] = 1;
+        piece.push_back(ring[from]);
+        size_t to = outgoing[from][slot];
+
+        // smallest clockwise turn from the way back
+        double back = std::atan2(Y(from) - Y(to), X(from) - X(to));
+        double best = 0;
+        slot = outgoing[to].size();
+
+        for (size_t s = 0; s < outgoing[to].size(); ++s)
+        {
+          size_t w = outgoing[to][s];
+          double angle = back - std::atan2(Y(w) - Y(to), X(w) - X(to));
+
+          while (angle <= 0)
+            angle += 2 * pi;
+
+          if (w == from)
+            angle = 2 * pi;
+
+          if (slot == outgoing[to].size() || angle < best)
+          {
+            best = angle;
+            slot = s;
+          }
+        }
+
+        from = to;
+      }
+
+      detail::triangulateMonotonePiece(x, y, piece, triangles);
+    }
+  }
+
+  // check the triangles cover the polygon exactly once
+  double covered = 0;
+
+  for (size_t t = 0; t < triangles.size(); t += 3)
+    covered += detail::cross(x, y, triangles[t], triangles[t + 1],
+                             triangles[t + 2]);
+
+  return triangles.size() == 3 * (n - 2) &&
+         std::fabs(covered - area) <= 1e-9 * std::max(area, 1.0);
+}
+
+// ----------------------------------------------------------------------------
+// Triangulate a polygon, monotone decomposition first, ear clipping when the
+// polygon is not simple. Repeated consecutive points are skipped.
+// ----------------------------------------------------------------------------
+inline std::vector<uint32_t> triangulate(const std::vector<double>& x,
+                                         const std::vector<double>& y)
+{
+  std::vector<uint32_t> ring;
+  std::vector<uint32_t> triangles;
+
+  for (uint32_t i = 0; i < x.size(); ++i)
+    if (ring.empty() || x[i] != x[ring.back()] || y[i] != y[ring.back()])
+      ring.push_back(i);
+
+  while (ring.size() > 1 && x[ring.front()] == x[ring.back()] &&
+         y[ring.front()] == y[ring.back()])
+    ring.pop_back();
+
+  if (ring.size() < 3 || detail::ringArea(x, y, ring) == 0)
+    return triangles;
+
+  if (!triangulateMonotone(x, y, ring, triangles))
+  {
+    triangles.clear();
+    triangulateEarClipping(x, y, ring, triangles);
+  }
+
+  return triangles;
+}
+
+} // end namespace Utils
@@ -192,25 +192,25 @@ public:
     Point2D<T> right(endPoint.x() + arrowLength * std::cos(angle + arrowDeg),
                      endPoint.y() + arrowLength * std::sin(angle + arrowDeg));
 
-    glLineWidth(lineWidth);
+    renderLineWidth(lineWidth);
     color.setGLColor();
 
-    glBegin(GL_LINES);
+    renderBegin(GL_LINES);
     glVertex2<T>(p);
     glVertex2<T>(endPoint);
-    glEnd();
+    renderEnd();
 
-    glBegin(GL_POLYGON);
+    renderBegin(GL_POLYGON);
     glVertex2<T>(endPoint);
     glVertex2<T>(left);
     glVertex2<T>(right);
-    glEnd();
+    renderEnd();
 
-    glBegin(GL_LINE_LOOP);
+    renderBegin(GL_LINE_LOOP);
     glVertex2<T>(endPoint);
     glVertex2<T>(left);
     glVertex2<T>(right);
-    glEnd();
+    renderEnd();
   }
 
 }; // end class Vector2D
@@ -106,7 +106,7 @@ public:
   {
     xp += v.xp;
     yp += v.yp;
-    yp += v.zp;
+    zp += v.zp;
     return *this;
   }
 
@@ -115,7 +115,7 @@ public:
   {
     xp -= v.xp;
     yp -= v.yp;
-    yp -= v.zp;
+    zp -= v.zp;
     return *this;
   }
 
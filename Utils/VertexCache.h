@@ -0,0 +1,190 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+namespace Utils
+{
+
+// ----------------------------------------------------------------------------
+// Vertex cache helpers working on plain index lists. Face i uses
+// indices[faceStarts[i]] .. indices[faceStarts[i + 1] - 1].
+// ----------------------------------------------------------------------------
+
+// ----------------------------------------------------------------------------
+// Average cache miss ratio: transformed vertices per face corner of a FIFO
+// post-transform cache, counted per triangle of a fan triangulation. 0.5 is
+// the ideal for large triangle meshes, 3 means no reuse at all.
+// ----------------------------------------------------------------------------
+inline double acmr(const std::vector<uint32_t>& indices,
+                   const std::vector<uint32_t>& faceStarts,
+                   size_t vertexCount, size_t cacheSize = 16)
+{
+  // time each vertex entered the cache, a vertex is cached if it entered
+  // less than cacheSize misses ago
+  std::vector<size_t> entered(vertexCount, 0);
+  std::vector<char> seen(vertexCount, 0);
+  size_t misses = 0;
+  size_t triangles = 0;
+
+  for (size_t f = 0; f + 1 < faceStarts.size(); ++f)
+  {
+    for (uint32_t k = faceStarts[f]; k < faceStarts[f + 1]; ++k)
+    {
+      uint32_t v = indices[k];
+
+      if (!seen[v] || misses - entered[v] >= cacheSize)
+      {
+        seen[v] = 1;
+        entered[v] = misses++;
+      }
+    }
+
+    uint32_t corners = faceStarts[f + 1] - faceStarts[f];
+    triangles += corners > 2 ? corners - 2 : 0;
+  }
+
+  return triangles ? static_cast<double>(misses) / triangles : 0.0;
+}
+
+// ----------------------------------------------------------------------------
+// Face order for a FIFO vertex cache of cacheSize entries, after Sander,
+// Nehab and Barczak, "Fast Triangle Reordering for Vertex Locality and
+// Reduced Overdraw" (Tipsify), extended to polygons. Runs in linear time.
+// Returns the new position's old face index.
+// ----------------------------------------------------------------------------
+inline std::vector<uint32_t> tipsify(const std::vector<uint32_t>& indices,
+                                     const std::vector<uint32_t>& faceStarts,
+                                     size_t vertexCount,
+                                     size_t cacheSize = 16)
+{
+  size_t faceCount = faceStarts.empty() ? 0 : faceStarts.size() - 1;
+  std::vector<uint32_t> order;
+  order.reserve(faceCount);
+
+  // faces around every vertex, as offsets into one array
+  std::vector<uint32_t> adjacencyStart(vertexCount + 1, 0);
+
+  for (auto v : indices)
+    adjacencyStart[v + 1]++;
+
+  for (size_t v = 0; v < vertexCount; ++v)
+    adjacencyStart[v + 1] += adjacencyStart[v];
+
+  std::vector<uint32_t> adjacency(indices.size());
+  std::vector<uint32_t> fill(adjacencyStart.begin(), adjacencyStart.end() - 1);
+
+  for (uint32_t f = 0; f < faceCount; ++f)
+    for (uint32_t k = faceStarts[f]; k < faceStarts[f + 1]; ++k)
+      adjacency[fill[indices[k]]++] = f;
+
+  std::vector<uint32_t> live(vertexCount);
+
+  for (size_t v = 0; v < vertexCount; ++v)
+    live[v] = adjacencyStart[v + 1] - adjacencyStart[v];
+
+  std::vector<size_t> cacheTime(vertexCount, 0);
+  std::vector<char> emitted(faceCount, 0);
+  std::vector<uint32_t> deadEnd;
+  std::vector<uint32_t> candidates;
+  size_t time = cacheSize + 1;
+  size_t cursor = 0;
+  const uint32_t none = 0xffffffff;
+  uint32_t fan = vertexCount ? 0 : none;
+
+  while (fan != none)
+  {
+    candidates.clear();
+
+    // emit all faces around the fanning vertex
+    for (uint32_t a = adjacencyStart[fan]; a < adjacencyStart[fan + 1]; ++a)
+    {
+      uint32_t f = adjacency[a];
+
+      if (emitted[f])
+        continue;
+
+      emitted[f] = 1;
+      order.push_back(f);
+
+      for (uint32_t k = faceStarts[f]; k < faceStarts[f + 1]; ++k)
+      {
+        uint32_t v = indices[k];
+        deadEnd.push_back(v);
+        candidates.push_back(v);
+        live[v]--;
+
+        if (time - cacheTime[v] > cacheSize)
+          cacheTime[v] = time++;
+      }
+    }
+
+    // next fan: the candidate staying longest in the cache that still has
+    // faces left, unless its faces would push it out
+    uint32_t next = none;
+    size_t best = 0;
+
+    for (auto v : candidates)
+    {
+      if (live[v] == 0)
+        continue;
+
+      size_t priority = 0;
+
+      if (time - cacheTime[v] + 2 * live[v] <= cacheSize)
+        priority = time - cacheTime[v];
+
+      if (next == none || priority > best)
+      {
+        best = priority;
+        next = v;
+      }
+    }
+
+    // dead end: recently used vertices first, then scan the rest
+    while (next == none && !deadEnd.empty())
+    {
+      uint32_t v = deadEnd.back();
+      deadEnd.pop_back();
+
+      if (live[v] > 0)
+        next = v;
+    }
+
+    while (next == none && cursor < vertexCount)
+    {
+      if (live[cursor] > 0)
+        next = static_cast<uint32_t>(cursor);
+
+      ++cursor;
+    }
+
+    fan = next;
+  }
+
+  return order;
+}
+
+// ----------------------------------------------------------------------------
+// 63 bit Morton code of a point quantized to 21 bits per axis. Coordinates
+// are expected in [0, 1].
+// ----------------------------------------------------------------------------
+inline uint64_t mortonCode(double x, double y, double z)
+{
+  auto spread = [](double value) -> uint64_t
+  {
+    value = std::min(std::max(value, 0.0), 1.0);
+    uint64_t v = static_cast<uint64_t>(value * 2097151.0);
+    v = (v | v << 32) & 0x1f00000000ffffULL;
+    v = (v | v << 16) & 0x1f0000ff0000ffULL;
+    v = (v | v << 8) & 0x100f00f00f00f00fULL;
+    v = (v | v << 4) & 0x10c30c30c30c30c3ULL;
+    v = (v | v << 2) & 0x1249249249249249ULL;
+    return v;
+  };
+
+  return spread(x) | spread(y) << 1 | spread(z) << 2;
+}
+
+} // end namespace Utils
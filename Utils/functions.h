@@ -1,5 +1,8 @@
 #pragma once
 #include <cmath>
+#include <map>
+#include <utility>
+#include <vector>
 
 namespace Utils
 {
@@ -12,14 +15,36 @@ double degToRad(double deg)
 }
 
 // ----------------------------------------------------------------------------
-// Calculate binomial coefficient [recursive]
+// Calculate binomial coefficient [constexpr, O(k)]. Every partial product
+// C(n, j - 1) * (n - j + 1) is divisible by j, so the result is exact as
+// long as it fits.
 // ----------------------------------------------------------------------------
-size_t binomialCoeff(size_t n, size_t k)
+constexpr size_t binomialCoeff(size_t n, size_t k)
 {
-  if (k == 0 || k == n)
-    return 1;
+  return k > n ? 0 :
+         k == 0 ? 1 : binomialCoeff(n, k - 1) * (n - k + 1) / k;
+}
+
+// ----------------------------------------------------------------------------
+// Returns row n of Pascal's triangle [cached, grows on demand]. Doubles, so
+// rows past n = 66 do not overflow.
+// ----------------------------------------------------------------------------
+const std::vector<double>& binomialRow(size_t n)
+{
+  static std::vector<std::vector<double>> rows(1, std::vector<double>(1, 1));
+
+  while (rows.size() <= n)
+  {
+    const auto& last = rows.back();
+    std::vector<double> row(last.size() + 1, 1);
+
+    for (size_t k = 1; k < last.size(); ++k)
+      row[k] = last[k - 1] + last[k];
+
+    rows.push_back(std::move(row));
+  }
 
-  return binomialCoeff(n - 1, k - 1) + binomialCoeff(n - 1, k);
+  return rows[n];
 }
 
 // ----------------------------------------------------------------------------
@@ -27,7 +52,68 @@ size_t binomialCoeff(size_t n, size_t k)
 // ----------------------------------------------------------------------------
 double bernsteinPolynomial(size_t n, size_t i, double t)
 {
-  return binomialCoeff(n, i) * std::pow(t, i) * std::pow(1 - t, n - i);
+  return binomialRow(n)[i] * std::pow(t, i) * std::pow(1 - t, n - i);
+}
+
+// ----------------------------------------------------------------------------
+// All Bernstein polynomials of degree n at t, without pow: the powers of t
+// are built up forwards and those of 1 - t backwards.
+// ----------------------------------------------------------------------------
+void bernsteinBasis(size_t n, double t, std::vector<double>& basis)
+{
+  const auto& binomials = binomialRow(n);
+  basis.resize(n + 1);
+
+  double power = 1;
+
+  for (size_t i = 0; i <= n; ++i)
+  {
+    basis[i] = binomials[i] * power;
+    power *= t;
+  }
+
+  power = 1;
+
+  for (size_t i = n + 1; i-- > 0;)
+  {
+    basis[i] *= power;
+    power *= 1 - t;
+  }
+}
+
+// ----------------------------------------------------------------------------
+// Sine and cosine of the angles i * 2PI / steps, for i = 0 .. steps - 1.
+// ----------------------------------------------------------------------------
+struct TrigTable
+{
+  std::vector<double> sin;
+  std::vector<double> cos;
+};
+
+// ----------------------------------------------------------------------------
+// Returns the trig table for a step count [cached per step count]
+// ----------------------------------------------------------------------------
+const TrigTable& trigTable(size_t steps)
+{
+  static std::map<size_t, TrigTable> cache;
+
+  auto cached = cache.find(steps);
+
+  if (cached != cache.end())
+    return cached->second;
+
+  TrigTable& table = cache[steps];
+  table.sin.resize(steps);
+  table.cos.resize(steps);
+
+  for (size_t i = 0; i < steps; ++i)
+  {
+    double angle = 2 * Utils::PI * i / steps;
+    table.sin[i] = std::sin(angle);
+    table.cos[i] = std::cos(angle);
+  }
+
+  return table;
 }
 
 } // end namespace Utils